@@ -0,0 +1,168 @@
+/*
+// Compares json_parse_file against reading
+// the whole file first and then calling
+// json_parse, with a warm and a cold page
+// cache. Cold runs drop the file from the
+// cache with posix_fadvise, so they need
+// Linux; elsewhere only warm runs are done.
+//
+//   bench_file [path]
+//
+// Without a path a BENCH_MEGABYTES file is
+// written first and removed afterwards.
+*/
+#define _POSIX_C_SOURCE 200112L
+#define _FILE_OFFSET_BITS 64
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "json_c.h"
+
+#define BENCH_RUNS 5
+#define BENCH_MEGABYTES 64
+
+double bench_now()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+int bench_write_file(const char* path, size_t megabytes)
+{
+	FILE* file = fopen(path, "wb");
+	size_t written = 0;
+	size_t id = 0;
+	if (file == NULL)
+		return 0;
+	fputs("[", file);
+	while (written < megabytes * 1024 * 1024)
+	{
+		written += (size_t)fprintf(file,
+			"%s{\"id\": %lu, \"name\": \"user %lu\", \"score\": %lu.%02lu, \"tags\": [\"a\", \"b\", \"c\"], \"active\": %s}\n",
+			id > 0 ? "," : "", (unsigned long)id, (unsigned long)id, (unsigned long)(id % 1000), (unsigned long)(id % 100),
+			id % 3 ? "true" : "false");
+		++id;
+	}
+	fputs("]", file);
+	return fclose(file) == 0;
+}
+
+/* Drops the file from the page cache, returns 0 where that is not possible. */
+int bench_drop_cache(const char* path)
+{
+#if __linux__
+	int fd = open(path, O_RDONLY);
+	int dropped = 0;
+	if (fd < 0)
+		return 0;
+	fdatasync(fd);
+	dropped = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+	close(fd);
+	return dropped;
+#else
+	(void)path;
+	return 0;
+#endif
+}
+
+/* Reads the whole file, then parses it. */
+struct json_value bench_read_then_parse(const char* path, double* read_time, struct json_error* error)
+{
+	struct json_value root;
+	double start = bench_now();
+	FILE* file = fopen(path, "rb");
+	char* text = NULL;
+	off_t size = 0;
+	memset(&root, 0, sizeof(root));
+	error->failed_parse = 1;
+	if (file == NULL)
+		return root;
+	fseeko(file, 0, SEEK_END);
+	size = ftello(file);
+	fseeko(file, 0, SEEK_SET);
+	text = (char*)malloc((size_t)size + 1);
+	if (text != NULL && fread(text, 1, (size_t)size, file) == (size_t)size)
+	{
+		*read_time = bench_now() - start;
+		root = json_parse(text, (size_t)size, error);
+	}
+	fclose(file);
+	free(text);
+	return root;
+}
+
+int bench_compare(const char* path)
+{
+	int cold;
+	int run;
+	for (cold = 0; cold < 2; ++cold)
+	{
+		double read_parse_best = 1e9, read_best = 1e9, pipe_best = 1e9;
+		double read_parse_total = 0.0, read_total = 0.0, pipe_total = 0.0;
+		if (cold && !bench_drop_cache(path))
+		{
+			printf("cold: not supported here\n");
+			break;
+		}
+		for (run = 0; run < BENCH_RUNS; ++run)
+		{
+			struct json_error error;
+			struct json_value root;
+			double read_time = 0.0;
+			double start;
+			double elapsed;
+			if (cold)
+				bench_drop_cache(path);
+			start = bench_now();
+			root = bench_read_then_parse(path, &read_time, &error);
+			elapsed = bench_now() - start;
+			if (error.failed_parse)
+				return 0;
+			json_destroy(root);
+			read_parse_total += elapsed;
+			read_total += read_time;
+			read_parse_best = elapsed < read_parse_best ? elapsed : read_parse_best;
+			read_best = read_time < read_best ? read_time : read_best;
+
+			if (cold)
+				bench_drop_cache(path);
+			start = bench_now();
+			root = json_parse_file(path, 0, &error);
+			elapsed = bench_now() - start;
+			if (error.failed_parse)
+				return 0;
+			json_destroy(root);
+			pipe_total += elapsed;
+			pipe_best = elapsed < pipe_best ? elapsed : pipe_best;
+		}
+		printf("%s: read %.3f s (best %.3f), read + json_parse %.3f s (best %.3f), json_parse_file %.3f s (best %.3f)\n",
+			cold ? "cold" : "warm",
+			read_total / BENCH_RUNS, read_best,
+			read_parse_total / BENCH_RUNS, read_parse_best,
+			pipe_total / BENCH_RUNS, pipe_best);
+	}
+	return 1;
+}
+
+int main(int argc, char** argv)
+{
+	const char* path = argc > 1 ? argv[1] : "bench_file.json";
+	if (argc <= 1 && !bench_write_file(path, BENCH_MEGABYTES))
+	{
+		printf("Unable to write %s\n", path);
+		return 1;
+	}
+	if (!bench_compare(path))
+	{
+		printf("Parse failed\n");
+		return 1;
+	}
+	if (argc <= 1)
+		remove(path);
+	return 0;
+}
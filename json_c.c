@@ -7,11 +7,28 @@
 #if __cplusplus
 JSON_C_BEGIN_EXTERN_C
 #endif
+#if !_WIN32
+/* 64 bit off_t for fseeko and ftello, also on 32 bit systems. */
+#ifndef _FILE_OFFSET_BITS
+#define _FILE_OFFSET_BITS 64
+#endif
+#if __STRICT_ANSI__ && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L
+#endif
+#endif
 #include "json_c.h"
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#if !JSON_C_NO_THREADS
+#if _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+#endif
 
 #ifndef JSON_C_FORCEINLINE
 #if _MSC_VER
@@ -28,6 +45,20 @@ JSON_C_BEGIN_EXTERN_C
 #define JSON_C_NEW(T) (T*)json_malloc(sizeof(T))
 #define JSON_C_NEWARRAY(T, C) (T*)json_malloc(sizeof(T) * C)
 #endif
+#ifndef JSON_C_MAX_DEPTH
+#define JSON_C_MAX_DEPTH 1024
+#endif
+#ifndef JSON_C_FILE_CHUNK
+#define JSON_C_FILE_CHUNK (4 * 1024 * 1024)
+#endif
+#ifndef JSON_C_POOL_SLAB
+#define JSON_C_POOL_SLAB (64 * 1024)
+#endif
+#define JSON_C_POOL_FIRST_SLAB 512
+#define JSON_C_POOL_CLASSES 44
+#define JSON_C_POOL_MAX_BLOCK (32 * 1024)
+/* 64 bit constants without the C99 ULL suffix. */
+#define JSON_C_U64(high, low) (((json_uint64)(high) << 32) | (json_uint64)(low))
 
 /*
 //////////////////////////////////////
@@ -38,8 +69,7 @@ JSON_C_BEGIN_EXTERN_C
 */
 enum JSON_TOKTYPE
 {
-	TOKTYPE_FLOAT,
-	TOKTYPE_INT,
+	TOKTYPE_NUMBER,
 	TOKTYPE_STRING,
 	TOKTYPE_TRUE,
 	TOKTYPE_FALSE,
@@ -58,11 +88,10 @@ struct json_lex_token
 
 	enum JSON_TOKTYPE token_type;
 	size_t chars_count;
-	size_t line;
+	size_t offset;
 	union
 	{
-		double float_value;
-		int int_value;
+		struct json_value number_value;
 		char* chars_value;
 		unsigned int bool_value : 1;
 	};
@@ -76,6 +105,95 @@ struct json_lex_tokenstream
 /*
 //////////////////////////////////////
 //
+// JSON Document Structs
+//
+//////////////////////////////////////
+*/
+/*
+// Array elements and object members are
+// allocated with this header in front of
+// them. parent is the header of the list
+// holding the container, so a change can
+// reach every container above it. The rest
+// is only needed by some lists and lives in
+// extra, which is allocated on first use.
+*/
+struct json_list_header
+{
+	struct json_list_header* parent;
+	struct json_list_extra* extra;
+};
+
+/*
+// capacity is 0 while it equals the size of
+// the list, which is the case for parsed
+// lists. The root list of a document keeps
+// the pool all its lists come from, and
+// owns_pool if json_destroy frees the pool.
+*/
+struct json_list_extra
+{
+	struct json_index* indexes;
+	json_uint64 hash;
+	size_t capacity;
+	struct json_pool* pool;
+	int owns_pool;
+};
+
+/*
+// Size class pool for the list blocks of a
+// document. Classes step by 16 bytes up to
+// 256 and then by a quarter of the power of
+// two below, up to 32 KB; larger blocks use
+// json_malloc directly. Blocks are carved
+// from slabs that double in size up to
+// JSON_C_POOL_SLAB and go back to a free list
+// when released. The pools of documents put
+// into this one are chained to absorbed and
+// freed together with it.
+*/
+struct json_pool_slab
+{
+	struct json_pool_slab* next;
+};
+
+struct json_pool
+{
+	void* free_lists[JSON_C_POOL_CLASSES];
+	struct json_pool_slab* slabs;
+	char* slab_next;
+	size_t slab_left;
+	size_t slab_size;
+	struct json_pool* absorbed;
+	struct json_pool* next_absorbed;
+};
+
+struct json_index_entry
+{
+	int is_string;
+	json_int64 int_key;
+	const char* string_key;
+	size_t string_size;
+	struct json_value* element;
+};
+
+/*
+// An index outlives changes to its array so
+// that handles stay usable. A change drops
+// the entries and clears is_valid until the
+// index is built again.
+*/
+struct json_index
+{
+	struct json_index* next;
+	char* key_path;
+	int is_valid;
+	size_t entry_count;
+	struct json_index_entry* entries;
+};
+/*
+//////////////////////////////////////
+//
 // Private Declarations
 //
 //////////////////////////////////////
@@ -85,11 +203,24 @@ struct json_lex_token* json_util_newtoken(enum JSON_TOKTYPE token_type);
 struct json_lex_tokenstream* json_util_newtokenstream();
 void json_util_free_token(struct json_lex_token* token);
 void json_util_free_tokenstream(struct json_lex_tokenstream* stream);
-struct json_array json_parse_array(struct json_lex_token** token, struct json_error* error);
-struct json_value json_parse_value(struct json_lex_token** token, struct json_error* error);
-void json_parse_members(struct json_lex_token** token, struct json_pair* store, size_t element_count, struct json_error* error);
-struct json_object json_parse_object(struct json_lex_token** token, struct json_error* error);
-void json_free_value(struct json_value value);
+void json_parse_array(struct json_lex_token** token, struct json_value* value, struct json_pool* pool, struct json_error* error);
+struct json_value json_parse_value(struct json_lex_token** token, struct json_pool* pool, struct json_error* error);
+void json_parse_members(struct json_lex_token** token, struct json_pair* store, size_t element_count, struct json_pool* pool, struct json_error* error);
+void json_parse_object(struct json_lex_token** token, struct json_value* value, struct json_pool* pool, struct json_error* error);
+struct json_reparse_edit;
+void json_free_value(struct json_value value, struct json_pool* pool);
+void json_util_replace_value(struct json_value* slot, struct json_value value, struct json_list_header* parent);
+void json_index_free(struct json_index* index);
+void json_index_invalidate(struct json_index* index);
+int json_lex_range(struct json_lex_tokenstream* stream, const char* text, size_t text_size, int is_final, unsigned int flags, size_t* lex_index, struct json_error* error);
+struct json_value json_parse_tokens(struct json_lex_tokenstream* stream, unsigned int flags, struct json_pool* pool, struct json_error* error);
+struct json_value json_parse_in_pool(const char* text, size_t text_size, unsigned int flags, struct json_pool* pool, struct json_error* error);
+int json_reparse_value(struct json_reparse_edit* edit, struct json_value* value, struct json_list_header* parent, size_t begin, size_t* end, size_t depth);
+const char* json_check_string(const char* text, size_t text_size, size_t* lex_index);
+const char* json_check_number(const char* text, size_t text_size, size_t* lex_index, int* is_float);
+int json_check_literal(const char* text, size_t text_size, size_t lex_index, const char* name, size_t name_size);
+const char* json_validate_value(const char* text, size_t text_size, size_t* index, size_t depth);
+json_uint64 json_hash_value(const struct json_value* value, int store);
 /*
 //////////////////////////////////////
 //
@@ -98,26 +229,90 @@ void json_free_value(struct json_value value);
 //////////////////////////////////////
 */
 #define ERR_JSON_MSG_LEX_INVALID_TOKEN "Invalid Token"
+#define ERR_JSON_MSG_LEX_UNTERMINATED_STRING "Unterminated string"
+#define ERR_JSON_MSG_LEX_INVALID_ESCAPE "Invalid escape sequence"
+#define ERR_JSON_MSG_LEX_CONTROL_CHAR "Control character in string"
+#define ERR_JSON_MSG_LEX_INVALID_NUMBER "Invalid number"
 #define ERR_JSON_MSG_PAR_INVALID_VALUE "Invalid Value"
 #define ERR_JSON_MSG_PAR_MISSING_RSQBR "Missing ]"
 #define ERR_JSON_MSG_PAR_MISSING_COMMA "Missing ,"
 #define ERR_JSON_MSG_PAR_INVALID_PAIR "Invalid pair value"
 #define ERR_JSON_MSG_PAR_MISSING_LBRACE "Missing }"
+#define ERR_JSON_MSG_PAR_MISSING_COLON "Missing :"
+#define ERR_JSON_MSG_PAR_MAX_DEPTH "Maximum depth exceeded"
+#define ERR_JSON_MSG_PAR_UNEXPECTED_END "Unexpected end of input"
+#define ERR_JSON_MSG_PAR_TRAILING "Unexpected data after value"
+#define ERR_JSON_MSG_IO_OPEN "Unable to open file"
+#define ERR_JSON_MSG_IO_READ "Unable to read file"
+#define ERR_JSON_MSG_IO_SIZE "File too large"
+#define ERR_JSON_MSG_PAR_INVALID_EDIT "Invalid edit range"
 
-static size_t json_global_line = 1;
+/*
+// Errors only record a byte offset. Line and
+// column are worked out by json_error_locate
+// once parsing has failed. The only location
+// work on the success path is the offset
+// each token keeps for the parser's errors.
+*/
+#define JSON_C_OFFSET_END ((size_t)-1)
 
-void json_emit_error(struct json_error* error, struct json_lex_token* token, const char* error_msg)
+void json_emit_error_at(struct json_error* error, size_t offset, const char* error_msg)
 {
 	if (error != NULL && !error->failed_parse)
 	{
 		error->failed_parse = 1;
-		if (token != NULL)
-			error->line = token->line;
-		else
-			error->line = json_global_line;
+		error->line = 0;
+		error->column = 0;
+		error->offset = offset;
 		error->message = error_msg;
 	}
 }
+
+void json_emit_error(struct json_error* error, struct json_lex_token* token, const char* error_msg)
+{
+	json_emit_error_at(error, token != NULL ? token->offset : JSON_C_OFFSET_END, error_msg);
+}
+
+/*
+// Counts newlines eight bytes at a time. A
+// byte of x is zero exactly where the word
+// holds a newline, and the zero byte test
+// below has no false positives, so the high
+// bits left in found can be summed directly.
+*/
+size_t json_count_newlines(const char* text, size_t size)
+{
+	const json_uint64 ones = JSON_C_U64(0x01010101, 0x01010101);
+	const json_uint64 low_bits = JSON_C_U64(0x7f7f7f7f, 0x7f7f7f7f);
+	size_t count = 0;
+	size_t index = 0;
+	for (; index + 8 <= size; index += 8)
+	{
+		json_uint64 word;
+		json_uint64 found;
+		memcpy(&word, &text[index], 8);
+		word ^= ones * '\n';
+		found = ~(((word & low_bits) + low_bits) | word) & ~low_bits;
+		count += (size_t)(((found >> 7) * ones) >> 56);
+	}
+	for (; index < size; ++index)
+		count += text[index] == '\n';
+	return count;
+}
+
+void json_error_locate(struct json_error* error, const char* text, size_t text_size)
+{
+	size_t line_start;
+	if (error == NULL || !error->failed_parse)
+		return;
+	if (error->offset > text_size)
+		error->offset = text_size;
+	line_start = error->offset;
+	while (line_start > 0 && text[line_start - 1] != '\n')
+		--line_start;
+	error->line = (int)json_count_newlines(text, line_start) + 1;
+	error->column = (int)(error->offset - line_start) + 1;
+}
 /*
 //////////////////////////////////////
 //
@@ -127,7 +322,6 @@ void json_emit_error(struct json_error* error, struct json_lex_token* token, con
 */
 JSON_C_FORCEINLINE void json_util_append_token(struct json_lex_tokenstream* stream, struct json_lex_token* token)
 {
-	token->line = json_global_line;
 	if (stream->head == NULL)
 	{
 		stream->head = token;
@@ -149,551 +343,2496 @@ JSON_C_FORCEINLINE char* json_util_copystr(const char* str, size_t size)
 	return new_str;
 }
 
-JSON_C_FORCEINLINE struct json_lex_token* json_util_newtoken(enum JSON_TOKTYPE token_type)
+static JSON_C_FORCEINLINE void json_util_init_alloc()
 {
-	struct json_lex_token* token = NULL;
-	token = (struct json_lex_token*)json_malloc(sizeof(struct json_lex_token));
-	token->next_token = NULL;
-	token->token_type = token_type;
-	return token;
+	if (json_malloc == NULL)
+		json_malloc = &malloc;
+	if (json_free == NULL)
+		json_free = &free;
 }
 
-JSON_C_FORCEINLINE struct json_lex_tokenstream* json_util_newtokenstream()
+/* The size class of block_size, JSON_C_POOL_CLASSES if it is too large. */
+static JSON_C_FORCEINLINE int json_pool_class(size_t block_size)
 {
-	struct json_lex_tokenstream* stream = NULL;
-	stream = (struct json_lex_tokenstream*)json_malloc(sizeof(struct json_lex_tokenstream));
-	stream->head = NULL;
-	stream->next = NULL;
-	return stream;
+	size_t power = 256;
+	int size_class = 16;
+	if (block_size <= 256)
+		return block_size == 0 ? 0 : (int)((block_size + 15) / 16) - 1;
+	if (block_size > JSON_C_POOL_MAX_BLOCK)
+		return JSON_C_POOL_CLASSES;
+	while (power * 2 < block_size)
+	{
+		power *= 2;
+		size_class += 4;
+	}
+	return size_class + (int)((block_size - power - 1) / (power / 4));
 }
 
-JSON_C_FORCEINLINE void json_util_free_token(struct json_lex_token* token)
+static JSON_C_FORCEINLINE size_t json_pool_class_size(int size_class)
 {
-	if (token != NULL)
+	size_t power = 0;
+	if (size_class < 16)
+		return (size_t)(size_class + 1) * 16;
+	power = (size_t)256 << ((size_class - 16) / 4);
+	return power + power / 4 * (size_t)((size_class - 16) % 4 + 1);
+}
+
+struct json_pool* json_pool_create()
+{
+	struct json_pool* pool = JSON_C_NEW(struct json_pool);
+	memset(pool, 0, sizeof(struct json_pool));
+	return pool;
+}
+
+/* Frees pool and every pool it absorbed. */
+void json_pool_destroy(struct json_pool* pool)
+{
+	struct json_pool* next = NULL;
+	pool->next_absorbed = pool->absorbed;
+	for (; pool != NULL; pool = next)
 	{
-		if (token->token_type == TOKTYPE_STRING)
-			json_free(token->chars_value);
-		json_util_free_token(token->next_token);
-		json_free(token);
+		next = pool->next_absorbed;
+		while (pool->slabs != NULL)
+		{
+			struct json_pool_slab* slab = pool->slabs->next;
+			json_free(pool->slabs);
+			pool->slabs = slab;
+		}
+		json_free(pool);
 	}
 }
 
-JSON_C_FORCEINLINE void json_util_free_tokenstream(struct json_lex_tokenstream* stream)
+/* Makes owner free pool, and what pool absorbed, along with itself. */
+void json_pool_absorb(struct json_pool* owner, struct json_pool* pool)
 {
-	if (stream != NULL)
+	struct json_pool* last = pool;
+	pool->next_absorbed = pool->absorbed;
+	pool->absorbed = NULL;
+	while (last->next_absorbed != NULL)
+		last = last->next_absorbed;
+	last->next_absorbed = owner->absorbed;
+	owner->absorbed = pool;
+}
+
+void* json_pool_take(struct json_pool* pool, size_t block_size)
+{
+	int size_class = json_pool_class(block_size);
+	int tail_class = 0;
+	size_t class_size = 0;
+	size_t slab_size = 0;
+	void* block = NULL;
+	struct json_pool_slab* slab = NULL;
+	if (size_class >= JSON_C_POOL_CLASSES)
+		return json_malloc(block_size);
+	if (pool->free_lists[size_class] != NULL)
 	{
-		json_util_free_token(stream->head);
-		json_free(stream);
+		block = pool->free_lists[size_class];
+		pool->free_lists[size_class] = *(void**)block;
+		return block;
+	}
+	class_size = json_pool_class_size(size_class);
+	if (pool->slab_left < class_size)
+	{
+		/* The tail of the old slab is left to the free lists. */
+		while (pool->slab_left >= 16)
+		{
+			tail_class = json_pool_class(pool->slab_left);
+			if (tail_class >= JSON_C_POOL_CLASSES)
+				tail_class = JSON_C_POOL_CLASSES - 1;
+			if (json_pool_class_size(tail_class) > pool->slab_left)
+				--tail_class;
+			*(void**)pool->slab_next = pool->free_lists[tail_class];
+			pool->free_lists[tail_class] = pool->slab_next;
+			pool->slab_next += json_pool_class_size(tail_class);
+			pool->slab_left -= json_pool_class_size(tail_class);
+		}
+		pool->slab_size = pool->slab_size == 0 ? JSON_C_POOL_FIRST_SLAB : pool->slab_size * 2;
+		if (pool->slab_size > JSON_C_POOL_SLAB)
+			pool->slab_size = JSON_C_POOL_SLAB;
+		slab_size = pool->slab_size < class_size ? class_size : pool->slab_size;
+		slab = (struct json_pool_slab*)json_malloc(sizeof(struct json_pool_slab) + slab_size);
+		slab->next = pool->slabs;
+		pool->slabs = slab;
+		pool->slab_next = (char*)(slab + 1);
+		pool->slab_left = slab_size;
 	}
+	block = pool->slab_next;
+	pool->slab_next += class_size;
+	pool->slab_left -= class_size;
+	return block;
 }
+
 /*
-//////////////////////////////////////
-//
-// JSON Lexer Functions
-//
-//////////////////////////////////////
+// With a NULL pool the block stays in its
+// slab, which is about to be freed with the
+// pool. Blocks too large for the pool are
+// always freed.
 */
-JSON_C_FORCEINLINE int json_find(const char* text, char test)
+void json_pool_release(struct json_pool* pool, void* block, size_t block_size)
 {
-	int index = 0;
-	char current = text[index];
-	while (current != 0)
+	int size_class = json_pool_class(block_size);
+	if (size_class >= JSON_C_POOL_CLASSES)
+		json_free(block);
+	else if (pool != NULL)
 	{
-		if ((current = text[index++]) == test)
-		{
-			return 1;
-		}
+		*(void**)block = pool->free_lists[size_class];
+		pool->free_lists[size_class] = block;
 	}
+}
 
-	return 0;
+static JSON_C_FORCEINLINE size_t json_util_list_block(size_t element_size, size_t capacity)
+{
+	return sizeof(struct json_list_header) + element_size * capacity;
 }
 
-int json_scan_string(struct json_lex_token** token, const char* text, size_t* lex_index)
+void* json_pool_newlist(struct json_pool* pool, size_t element_size, size_t capacity)
 {
-	size_t index = *lex_index;
-	char current = text[index];
-	if (current == '"')
-	{
-		size_t start = ++index;
-		current = text[index];
-		while (current != '"' && current != 0)
-			current = text[++index];
-		*token = json_util_newtoken(TOKTYPE_STRING);
-		(*token)->chars_value = json_util_copystr(&text[start], index - start);
-		(*token)->chars_count = index - start;
-		*lex_index = index;
-		return 1;
-	}
-	return 0;
+	struct json_list_header* header = NULL;
+	header = (struct json_list_header*)json_pool_take(pool, json_util_list_block(element_size, capacity));
+	header->parent = NULL;
+	header->extra = NULL;
+	return header + 1;
 }
 
-int json_scan_int(struct json_lex_token** token, const char* text, size_t* lex_index)
+static JSON_C_FORCEINLINE struct json_list_header* json_util_list_header(const void* list)
 {
-	static const char* DIGITS = "-0123456789";
-	size_t index = *lex_index;
-	char current = text[index];
-	if (json_find(DIGITS, current))
-	{
-		size_t start = index++;
-		current = text[index];
-		while (json_find(DIGITS, current) && current != 0)
-			current = text[++index];
-		*token = json_util_newtoken(TOKTYPE_INT);
-		(*token)->int_value = atoi(&text[start]);
-		*lex_index = index - 1;
-		return 1;
-	}
-	return 0;
+	return (struct json_list_header*)list - 1;
 }
 
-int json_scan_float(struct json_lex_token** token, const char* text, size_t* lex_index)
+static JSON_C_FORCEINLINE struct json_list_extra* json_util_list_extra(const void* list)
 {
-	static const char* DIGITS = ".-+0123456789eE";
-	size_t index = *lex_index;
-	char current = text[index];
-	if (json_find(DIGITS, current))
+	struct json_list_header* header = json_util_list_header(list);
+	if (header->extra == NULL)
 	{
-		size_t start = index++;
-		current = text[index];
-		int found_dot = 0;
-		while (json_find(DIGITS, current) && current != 0)
-		{
-			if (!found_dot)
-				found_dot = current == '.';
-			current = text[++index];
-		}
-		if (!found_dot)
-			return 0;
-		*token = json_util_newtoken(TOKTYPE_FLOAT);
-		(*token)->float_value = atof(&text[start]);
-		*lex_index = index - 1;
-		return 1;
+		header->extra = (struct json_list_extra*)json_malloc(sizeof(struct json_list_extra));
+		memset(header->extra, 0, sizeof(struct json_list_extra));
 	}
-	return 0;
+	return header->extra;
 }
 
-int json_scan_true(struct json_lex_token** token, const char* text, size_t* lex_index)
+/* The values or members of a container, NULL for other values. */
+static JSON_C_FORCEINLINE void* json_util_value_list(const struct json_value* value)
 {
-	static const char* TRUE_NAME = "true";
-	size_t index = *lex_index;
-	if (text[index] == TRUE_NAME[0])
-	{
-		int i;
-		for (i = 1; i < 4; ++i)
-		{
-			if (text[index + i] != TRUE_NAME[i])
-				return 0;
-		}
-		*token = json_util_newtoken(TOKTYPE_TRUE);
-		(*token)->bool_value = 1;
-		*lex_index += 3;
-		return 1;
-	}
-	return 0;
+	if (json_type(value) == VAL_ARRAY)
+		return json_array_at(value, 0);
+	if (json_type(value) == VAL_OBJECT)
+		return json_object_at(value, 0);
+	return NULL;
 }
 
-int json_scan_false(struct json_lex_token** token, const char* text, size_t* lex_index)
+static JSON_C_FORCEINLINE struct json_list_header* json_util_value_header(const struct json_value* value)
 {
-	static const char* FALSE_NAME = "false";
-	size_t index = *lex_index;
-	if (text[index] == FALSE_NAME[0])
-	{
-		int i;
-		for (i = 1; i < 5; ++i)
-		{
-			if (text[index + i] != FALSE_NAME[i])
-				return 0;
-		}
-		*token = json_util_newtoken(TOKTYPE_FALSE);
-		(*token)->bool_value = 0;
-		*lex_index += 4;
-		return 1;
-	}
-	return 0;
+	void* list = json_util_value_list(value);
+	return list != NULL ? json_util_list_header(list) : NULL;
 }
 
-int json_scan_null(struct json_lex_token** token, const char* text, size_t* lex_index)
+/* The pool of the document holding the list with the given header. */
+static JSON_C_FORCEINLINE struct json_pool* json_util_header_pool(struct json_list_header* header)
 {
-	static const char* NULL_NAME = "null";
-	size_t index = *lex_index;
-	if (text[index] == NULL_NAME[0])
-	{
-		int i;
-		for (i = 1; i < 4; ++i)
-		{
-			if (text[index + i] != NULL_NAME[i])
-				return 0;
-		}
-		*token = json_util_newtoken(TOKTYPE_NULL);
-		*lex_index += 3;
-		return 1;
-	}
-	return 0;
+	if (header == NULL)
+		return NULL;
+	while (header->parent != NULL)
+		header = header->parent;
+	return header->extra != NULL ? header->extra->pool : NULL;
 }
 
-int json_scan_symbols(struct json_lex_token** token, const char* text, size_t* lex_index)
+/* Lists without a capacity were allocated for exactly size values. */
+static JSON_C_FORCEINLINE size_t json_util_list_capacity(const void* list, size_t size)
 {
-	switch (text[*lex_index])
-	{
-		case ',':
-			*token = json_util_newtoken(TOKTYPE_COMMA);
-			return 1;
-		case '{':
-			*token = json_util_newtoken(TOKTYPE_LBRACE);
-			return 1;
-		case '}':
-			*token = json_util_newtoken(TOKTYPE_RBRACE);
-			return 1;
-		case '[':
-			*token = json_util_newtoken(TOKTYPE_LSQBR);
-			return 1;
-		case ']':
-			*token = json_util_newtoken(TOKTYPE_RSQBR);
-			return 1;
-		case ':':
-			*token = json_util_newtoken(TOKTYPE_COLON);
-			return 1;
-	}
-	return 0;
+	struct json_list_extra* extra = json_util_list_header(list)->extra;
+	return extra != NULL && extra->capacity != 0 ? extra->capacity : size;
 }
 
-int json_scan_empty(const char* text, size_t* lex_index)
+/* Called before a list shrinks, so its block can still be released. */
+static JSON_C_FORCEINLINE void json_util_keep_capacity(const void* list, size_t size)
 {
-	static const char* EMPTY_NAME = " \n\t\r";
-	size_t index = *lex_index;
-	char current = text[index++];
-	if (json_find(EMPTY_NAME, current) || current == 0)
+	struct json_list_extra* extra = json_util_list_extra(list);
+	if (extra->capacity == 0)
+		extra->capacity = size;
+}
+
+/*
+// Drops what the lists from header up to the
+// root cache about their values after one of
+// the values below them changed.
+*/
+static JSON_C_FORCEINLINE void json_util_header_changed(struct json_list_header* header)
+{
+	for (; header != NULL; header = header->parent)
 	{
-		if (current == '\n')
-			++json_global_line;
-		current = text[index++];
-		while (json_find(EMPTY_NAME, current) || current == 0)
+		if (header->extra != NULL)
 		{
-			if (current == '\n')
-				++json_global_line;
-			current = text[index++];
+			json_index_invalidate(header->extra->indexes);
+			header->extra->hash = 0;
 		}
-		*lex_index = index - 1;
-		return 1;
 	}
-	return 0;
 }
 
-struct json_lex_tokenstream* json_lex(const char* text, size_t text_size, struct json_error* error)
+static JSON_C_FORCEINLINE void json_util_list_changed(const void* list)
 {
-	struct json_lex_tokenstream* stream = NULL;
-	size_t index = 0;
-	stream = json_util_newtokenstream();
-	json_global_line = 1;
-	while (index < text_size)
-	{
-		size_t last_index = index;
-		struct json_lex_token* token = NULL;
-		if (json_scan_empty(text, &index)) continue;
-		else if (json_scan_string(&token, text, &index));
-		else if (json_scan_null(&token, text, &index));
-		else if (json_scan_false(&token, text, &index));
-		else if (json_scan_true(&token, text, &index));
-		else if (json_scan_float(&token, text, &index));
-		else if (json_scan_int(&token, text, &index));
-		else if (json_scan_symbols(&token, text, &index));
-		else
-		{
-			json_emit_error(error, NULL, ERR_JSON_MSG_LEX_INVALID_TOKEN);
-			json_util_free_tokenstream(stream);
-			return NULL;
-		}
-		if (token != NULL)
-			json_util_append_token(stream, token);
+	json_util_header_changed(json_util_list_header(list));
+}
 
-		++index;
-	}
-	return stream;
+/* The header of the list holding value, if value is a container. */
+static JSON_C_FORCEINLINE struct json_list_header* json_util_value_parent(const struct json_value* value)
+{
+	struct json_list_header* header = json_util_value_header(value);
+	return header != NULL ? header->parent : NULL;
 }
-/*
-//////////////////////////////////////
-//
-// JSON Parser Functions
-//
-//////////////////////////////////////
-*/
-JSON_C_FORCEINLINE int json_simple_hash(const char* string, size_t len)
+
+/* Links a container to the header of the list it was put in. */
+static JSON_C_FORCEINLINE void json_util_adopt(const struct json_value* value, struct json_list_header* parent)
 {
-	int hash = 5301;
-	int i = len;
-	while (i)
-		hash = (hash * 33) ^ string[--i];
+	struct json_list_header* header = json_util_value_header(value);
+	if (header != NULL)
+		header->parent = parent;
+}
 
-	return hash;
+static JSON_C_FORCEINLINE void json_util_adopt_elements(struct json_value* elements, size_t size)
+{
+	size_t index;
+	for (index = 0; index < size; ++index)
+		json_util_adopt(&elements[index], json_util_list_header(elements));
 }
 
-void json_free_value(struct json_value value)
+static JSON_C_FORCEINLINE void json_util_adopt_members(struct json_pair* members, size_t count)
 {
 	size_t index;
-	if (value.type == VAL_STRING)
+	for (index = 0; index < count; ++index)
+		json_util_adopt(&members[index].value, json_util_list_header(members));
+}
+
+/*
+// Links a value put in a list to the list's
+// header. A document that comes with a pool
+// of its own hands it to the document it is
+// put in, which frees it with its own pool.
+*/
+static JSON_C_FORCEINLINE void json_util_insert(const struct json_value* value, struct json_list_header* parent)
+{
+	struct json_list_header* header = json_util_value_header(value);
+	struct json_pool* pool = NULL;
+	if (header == NULL)
+		return;
+	header->parent = parent;
+	if (header->extra == NULL || header->extra->pool == NULL)
+		return;
+	if (header->extra->owns_pool)
 	{
-		json_free(value.string_value.value);
+		pool = json_util_header_pool(parent);
+		if (pool == NULL)
+			return;
+		json_pool_absorb(pool, header->extra->pool);
 	}
-	else if (value.type == VAL_OBJECT)
+	header->extra->pool = NULL;
+	header->extra->owns_pool = 0;
+}
+
+static JSON_C_FORCEINLINE void json_util_free_list(void* list, size_t element_size, size_t size, struct json_pool* pool)
+{
+	struct json_list_header* header = json_util_list_header(list);
+	size_t capacity = json_util_list_capacity(list, size);
+	if (header->extra != NULL)
 	{
-		for (index = 0; index < value.object_value.object_count; ++index)
-		{
-			json_free_value(value.object_value.members[index].value);
-		}
-		json_free(value.object_value.members);
+		json_index_free(header->extra->indexes);
+		json_free(header->extra);
 	}
-	else if (value.type == VAL_ARRAY)
-	{
-		for (index = 0; index < value.array_value.array_size; ++index)
-		{
-			json_free_value(value.array_value.elements[index]);
+	json_pool_release(pool, header, json_util_list_block(element_size, capacity));
+}
+
+JSON_C_FORCEINLINE struct json_lex_token* json_util_newtoken(enum JSON_TOKTYPE token_type)
+{
+	struct json_lex_token* token = NULL;
+	token = (struct json_lex_token*)json_malloc(sizeof(struct json_lex_token));
+	token->next_token = NULL;
+	token->token_type = token_type;
+	return token;
+}
+
+JSON_C_FORCEINLINE struct json_lex_tokenstream* json_util_newtokenstream()
+{
+	struct json_lex_tokenstream* stream = NULL;
+	stream = (struct json_lex_tokenstream*)json_malloc(sizeof(struct json_lex_tokenstream));
+	stream->head = NULL;
+	stream->next = NULL;
+	return stream;
+}
+
+JSON_C_FORCEINLINE void json_util_free_token(struct json_lex_token* token)
+{
+	while (token != NULL)
+	{
+		struct json_lex_token* next_token = token->next_token;
+		if (token->token_type == TOKTYPE_STRING && token->chars_value != NULL)
+			json_free(token->chars_value);
+		json_free(token);
+		token = next_token;
+	}
+}
+
+JSON_C_FORCEINLINE void json_util_free_tokenstream(struct json_lex_tokenstream* stream)
+{
+	if (stream != NULL)
+	{
+		json_util_free_token(stream->head);
+		json_free(stream);
+	}
+}
+/*
+// Value setters. Together with the accessors
+// in json_c.h these are the only functions
+// that know about the node layout.
+*/
+#if JSON_C_COMPACT
+#define JSON_C_RAW_NUMBER_MAX 0xffffffffu
+static JSON_C_FORCEINLINE void json_util_set_null(struct json_value* value)
+{
+	value->float_value = 0.0;
+	value->size = 0;
+	value->type = VAL_NULL;
+	value->flags = 0;
+}
+
+static JSON_C_FORCEINLINE void json_util_set_string(struct json_value* value, const char* str, size_t size)
+{
+	json_util_set_null(value);
+	value->type = VAL_STRING;
+	value->size = (unsigned int)size;
+	if (size < JSON_C_INLINE_STRING)
+	{
+		memmove(value->inline_chars, str, size);
+		value->inline_chars[size] = 0;
+		value->flags = JSON_C_FLAG_INLINE;
+	}
+	else
+		value->string_chars = json_util_copystr(str, size);
+}
+
+static JSON_C_FORCEINLINE void json_util_set_float(struct json_value* value, double number)
+{
+	json_util_set_null(value);
+	value->type = VAL_NUMBER;
+	value->float_value = number;
+}
+
+static JSON_C_FORCEINLINE void json_util_set_int(struct json_value* value, json_int64 number)
+{
+	json_util_set_null(value);
+	value->type = VAL_NUMBER;
+	value->int_value = number;
+	value->flags = JSON_C_FLAG_INT;
+}
+
+static JSON_C_FORCEINLINE void json_util_set_uint(struct json_value* value, json_uint64 number)
+{
+	json_util_set_null(value);
+	value->type = VAL_NUMBER;
+	value->uint_value = number;
+	value->flags = JSON_C_FLAG_INT | JSON_C_FLAG_UINT;
+}
+
+static JSON_C_FORCEINLINE void json_util_set_raw_number(struct json_value* value, const char* text, size_t size, int is_float)
+{
+	json_util_set_null(value);
+	value->type = VAL_NUMBER;
+	value->raw_chars = text;
+	value->size = (unsigned int)size;
+	value->flags = JSON_C_FLAG_RAW | (is_float ? 0 : JSON_C_FLAG_INT);
+}
+
+static JSON_C_FORCEINLINE const char* json_util_raw_number(const struct json_value* value, size_t* size, int* is_float)
+{
+	*size = value->size;
+	*is_float = !(value->flags & JSON_C_FLAG_INT);
+	return value->raw_chars;
+}
+
+/* The node has no room for the digits and the value, see json_number_resolve. */
+static JSON_C_FORCEINLINE int json_util_number_resolved(const struct json_value* value)
+{
+	(void)value;
+	return 0;
+}
+
+static JSON_C_FORCEINLINE void json_util_set_resolved(struct json_value* value, const struct json_value* number)
+{
+	(void)value;
+	(void)number;
+}
+
+static JSON_C_FORCEINLINE void json_util_set_bool(struct json_value* value, int boolean)
+{
+	json_util_set_null(value);
+	value->type = VAL_BOOL;
+	value->flags = boolean ? JSON_C_FLAG_TRUE : 0;
+}
+
+static JSON_C_FORCEINLINE void json_util_set_array(struct json_value* value, struct json_value* elements, size_t size)
+{
+	json_util_set_null(value);
+	value->type = VAL_ARRAY;
+	value->elements = elements;
+	value->size = (unsigned int)size;
+}
+
+static JSON_C_FORCEINLINE void json_util_set_object(struct json_value* value, struct json_pair* members, size_t count)
+{
+	json_util_set_null(value);
+	value->type = VAL_OBJECT;
+	value->members = members;
+	value->size = (unsigned int)count;
+}
+
+static JSON_C_FORCEINLINE void json_util_free_string(struct json_value* value)
+{
+	if (!(value->flags & JSON_C_FLAG_INLINE))
+		json_free(value->string_chars);
+}
+#else
+#define JSON_C_RAW_NUMBER_MAX 0x1fffffffu
+static JSON_C_FORCEINLINE void json_util_set_null(struct json_value* value)
+{
+	memset(value, 0, sizeof(struct json_value));
+	value->type = VAL_NULL;
+}
+
+static JSON_C_FORCEINLINE void json_util_set_string(struct json_value* value, const char* str, size_t size)
+{
+	value->type = VAL_STRING;
+	value->string_value.value = json_util_copystr(str, size);
+	value->string_value.size = size;
+}
+
+static JSON_C_FORCEINLINE void json_util_set_float(struct json_value* value, double number)
+{
+	value->type = VAL_NUMBER;
+	value->number_type = NUM_FLOAT;
+	value->number_raw_size = 0;
+	value->number_resolved = 0;
+	value->number_value.float_value = number;
+}
+
+static JSON_C_FORCEINLINE void json_util_set_int(struct json_value* value, json_int64 number)
+{
+	value->type = VAL_NUMBER;
+	value->number_type = NUM_INT;
+	value->number_raw_size = 0;
+	value->number_resolved = 0;
+	value->number_value.int_value = number;
+}
+
+static JSON_C_FORCEINLINE void json_util_set_uint(struct json_value* value, json_uint64 number)
+{
+	value->type = VAL_NUMBER;
+	value->number_type = NUM_UINT;
+	value->number_raw_size = 0;
+	value->number_resolved = 0;
+	value->number_value.uint_value = number;
+}
+
+static JSON_C_FORCEINLINE void json_util_set_raw_number(struct json_value* value, const char* text, size_t size, int is_float)
+{
+	value->type = VAL_NUMBER;
+	value->number_type = is_float ? NUM_FLOAT : NUM_INT;
+	value->number_raw_size = (unsigned int)size;
+	value->number_resolved = 0;
+	value->number_value.raw_value = text;
+}
+
+/* After conversion type is the converted type, so is_float is only a hint. */
+static JSON_C_FORCEINLINE const char* json_util_raw_number(const struct json_value* value, size_t* size, int* is_float)
+{
+	*size = value->number_raw_size;
+	*is_float = value->number_type == NUM_FLOAT;
+	return value->number_value.raw_value;
+}
+
+static JSON_C_FORCEINLINE int json_util_number_resolved(const struct json_value* value)
+{
+	return value->number_resolved;
+}
+
+static JSON_C_FORCEINLINE void json_util_set_resolved(struct json_value* value, const struct json_value* number)
+{
+	const char* raw_value = value->number_value.raw_value;
+	value->number_type = number->number_type;
+	value->number_value = number->number_value;
+	value->number_value.raw_value = raw_value;
+	value->number_resolved = 1;
+}
+
+static JSON_C_FORCEINLINE void json_util_set_bool(struct json_value* value, int boolean)
+{
+	value->type = VAL_BOOL;
+	value->bool_value.value = boolean != 0;
+}
+
+static JSON_C_FORCEINLINE void json_util_set_array(struct json_value* value, struct json_value* elements, size_t size)
+{
+	value->type = VAL_ARRAY;
+	value->array_value.elements = elements;
+	value->array_value.array_size = size;
+}
+
+static JSON_C_FORCEINLINE void json_util_set_object(struct json_value* value, struct json_pair* members, size_t count)
+{
+	value->type = VAL_OBJECT;
+	value->object_value.members = members;
+	value->object_value.object_count = count;
+}
+
+static JSON_C_FORCEINLINE void json_util_free_string(struct json_value* value)
+{
+	json_free(value->string_value.value);
+}
+#endif
+
+#define JSON_C_INT64_MAX (~(json_uint64)0 >> 1)
+/*
+// Converts the checked digits of a number.
+// Integers are converted here, as strtoll is
+// C99, and fall back to float when they do
+// not fit 64 bits.
+*/
+void json_util_set_number(struct json_value* value, const char* text, size_t size, int is_float)
+{
+	char local_digits[64];
+	char* digits = local_digits;
+	json_uint64 magnitude = 0;
+	size_t index = text[0] == '-';
+	if (!is_float)
+	{
+		for (; index < size; ++index)
+		{
+			unsigned int digit = (unsigned int)(text[index] - '0');
+			if (magnitude > (~(json_uint64)0 - digit) / 10)
+				break;
+			magnitude = magnitude * 10 + digit;
+		}
+		if (index == size && text[0] != '-')
+		{
+			if (magnitude <= JSON_C_INT64_MAX)
+				json_util_set_int(value, (json_int64)magnitude);
+			else
+				json_util_set_uint(value, magnitude);
+			return;
+		}
+		if (index == size && magnitude <= JSON_C_INT64_MAX + 1)
+		{
+			json_util_set_int(value, magnitude <= JSON_C_INT64_MAX ? -(json_int64)magnitude : -(json_int64)JSON_C_INT64_MAX - 1);
+			return;
+		}
+	}
+	if (size >= sizeof(local_digits))
+		digits = (char*)json_malloc(size + 1);
+	if (digits == NULL)
+	{
+		json_util_set_float(value, 0.0);
+		return;
+	}
+	memmove(digits, text, size);
+	digits[size] = 0;
+	json_util_set_float(value, strtod(digits, NULL));
+	if (digits != local_digits)
+		json_free(digits);
+}
+
+const struct json_value* json_number_convert(const struct json_value* value, struct json_value* number)
+{
+	size_t size = 0;
+	int is_float = 0;
+	const char* text = NULL;
+	if (!json_number_is_raw(value) || json_util_number_resolved(value))
+		return value;
+	text = json_util_raw_number(value, &size, &is_float);
+	json_util_set_null(number);
+	json_util_set_number(number, text, size, is_float);
+	return number;
+}
+/*
+//////////////////////////////////////
+//
+// JSON Lexer Functions
+//
+//////////////////////////////////////
+*/
+JSON_C_FORCEINLINE int json_find(const char* text, char test)
+{
+	int index = 0;
+	char current = text[index];
+	while (current != 0)
+	{
+		if ((current = text[index++]) == test)
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static JSON_C_FORCEINLINE int json_is_hex(char c)
+{
+	return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+/*
+// Scanning core shared by the lexer and
+// the validator. These never allocate.
+// On success they return NULL and leave
+// lex_index on the last char of the token,
+// on failure they return the error message
+// and leave lex_index on the offending char.
+*/
+const char* json_check_string(const char* text, size_t text_size, size_t* lex_index)
+{
+	size_t index = *lex_index + 1;
+	while (index < text_size)
+	{
+		unsigned char current = (unsigned char)text[index];
+		if (current == '"')
+		{
+			*lex_index = index;
+			return NULL;
+		}
+		else if (current == '\\')
+		{
+			if (++index >= text_size)
+				break;
+			switch (text[index])
+			{
+				case '"': case '\\': case '/':
+				case 'b': case 'f': case 'n': case 'r': case 't':
+					break;
+				case 'u':
+					if (index + 4 >= text_size ||
+						!json_is_hex(text[index + 1]) || !json_is_hex(text[index + 2]) ||
+						!json_is_hex(text[index + 3]) || !json_is_hex(text[index + 4]))
+					{
+						*lex_index = index - 1;
+						return ERR_JSON_MSG_LEX_INVALID_ESCAPE;
+					}
+					index += 4;
+					break;
+				default:
+					*lex_index = index - 1;
+					return ERR_JSON_MSG_LEX_INVALID_ESCAPE;
+			}
+		}
+		else if (current < 0x20)
+		{
+			*lex_index = index;
+			return ERR_JSON_MSG_LEX_CONTROL_CHAR;
+		}
+		++index;
+	}
+	*lex_index = text_size;
+	return ERR_JSON_MSG_LEX_UNTERMINATED_STRING;
+}
+
+const char* json_check_number(const char* text, size_t text_size, size_t* lex_index, int* is_float)
+{
+	size_t index = *lex_index;
+	*is_float = 0;
+	if (index < text_size && text[index] == '-')
+		++index;
+	if (index >= text_size || text[index] < '0' || text[index] > '9')
+	{
+		*lex_index = index;
+		return ERR_JSON_MSG_LEX_INVALID_NUMBER;
+	}
+	if (text[index] == '0')
+		++index;
+	else
+	{
+		while (index < text_size && text[index] >= '0' && text[index] <= '9')
+			++index;
+	}
+	if (index < text_size && text[index] == '.')
+	{
+		*is_float = 1;
+		if (++index >= text_size || text[index] < '0' || text[index] > '9')
+		{
+			*lex_index = index;
+			return ERR_JSON_MSG_LEX_INVALID_NUMBER;
+		}
+		while (index < text_size && text[index] >= '0' && text[index] <= '9')
+			++index;
+	}
+	if (index < text_size && (text[index] == 'e' || text[index] == 'E'))
+	{
+		*is_float = 1;
+		if (++index < text_size && (text[index] == '+' || text[index] == '-'))
+			++index;
+		if (index >= text_size || text[index] < '0' || text[index] > '9')
+		{
+			*lex_index = index;
+			return ERR_JSON_MSG_LEX_INVALID_NUMBER;
+		}
+		while (index < text_size && text[index] >= '0' && text[index] <= '9')
+			++index;
+	}
+	*lex_index = index - 1;
+	return NULL;
+}
+
+int json_check_literal(const char* text, size_t text_size, size_t lex_index, const char* name, size_t name_size)
+{
+	return text_size - lex_index >= name_size && memcmp(&text[lex_index], name, name_size) == 0;
+}
+
+int json_scan_string(struct json_lex_token** token, const char* text, size_t text_size, size_t* lex_index)
+{
+	size_t index = *lex_index;
+	if (text[index] == '"')
+	{
+		size_t start = index + 1;
+		if (json_check_string(text, text_size, &index) != NULL)
+			return 0;
+		*token = json_util_newtoken(TOKTYPE_STRING);
+		(*token)->chars_value = json_util_copystr(&text[start], index - start);
+		(*token)->chars_count = index - start;
+		*lex_index = index;
+		return 1;
+	}
+	return 0;
+}
+
+int json_scan_number(struct json_lex_token** token, const char* text, size_t text_size, unsigned int flags, size_t* lex_index)
+{
+	size_t index = *lex_index;
+	int is_float = 0;
+	if (json_check_number(text, text_size, &index, &is_float) == NULL)
+	{
+		*token = json_util_newtoken(TOKTYPE_NUMBER);
+		if ((flags & PARSE_RAW_NUMBERS) && index + 1 - *lex_index <= JSON_C_RAW_NUMBER_MAX)
+			json_util_set_raw_number(&(*token)->number_value, &text[*lex_index], index + 1 - *lex_index, is_float);
+		else
+			json_util_set_number(&(*token)->number_value, &text[*lex_index], index + 1 - *lex_index, is_float);
+		*lex_index = index;
+		return 1;
+	}
+	return 0;
+}
+
+int json_scan_true(struct json_lex_token** token, const char* text, size_t text_size, size_t* lex_index)
+{
+	if (json_check_literal(text, text_size, *lex_index, "true", 4))
+	{
+		*token = json_util_newtoken(TOKTYPE_TRUE);
+		(*token)->bool_value = 1;
+		*lex_index += 3;
+		return 1;
+	}
+	return 0;
+}
+
+int json_scan_false(struct json_lex_token** token, const char* text, size_t text_size, size_t* lex_index)
+{
+	if (json_check_literal(text, text_size, *lex_index, "false", 5))
+	{
+		*token = json_util_newtoken(TOKTYPE_FALSE);
+		(*token)->bool_value = 0;
+		*lex_index += 4;
+		return 1;
+	}
+	return 0;
+}
+
+int json_scan_null(struct json_lex_token** token, const char* text, size_t text_size, size_t* lex_index)
+{
+	if (json_check_literal(text, text_size, *lex_index, "null", 4))
+	{
+		*token = json_util_newtoken(TOKTYPE_NULL);
+		*lex_index += 3;
+		return 1;
+	}
+	return 0;
+}
+
+int json_scan_symbols(struct json_lex_token** token, const char* text, size_t* lex_index)
+{
+	switch (text[*lex_index])
+	{
+		case ',':
+			*token = json_util_newtoken(TOKTYPE_COMMA);
+			return 1;
+		case '{':
+			*token = json_util_newtoken(TOKTYPE_LBRACE);
+			return 1;
+		case '}':
+			*token = json_util_newtoken(TOKTYPE_RBRACE);
+			return 1;
+		case '[':
+			*token = json_util_newtoken(TOKTYPE_LSQBR);
+			return 1;
+		case ']':
+			*token = json_util_newtoken(TOKTYPE_RSQBR);
+			return 1;
+		case ':':
+			*token = json_util_newtoken(TOKTYPE_COLON);
+			return 1;
+	}
+	return 0;
+}
+
+int json_scan_empty(const char* text, size_t text_size, size_t* lex_index)
+{
+	static const char* EMPTY_NAME = " \n\t\r";
+	size_t index = *lex_index;
+	char current = text[index];
+	if (json_find(EMPTY_NAME, current) || current == 0)
+	{
+		while (index < text_size)
+		{
+			current = text[index];
+			if (!json_find(EMPTY_NAME, current) && current != 0)
+				break;
+			++index;
+		}
+		*lex_index = index;
+		return 1;
+	}
+	return 0;
+}
+
+/*
+// Lexes text from lex_index up to text_size.
+// When is_final is 0 more text may follow, so
+// a token that fails or touches text_size is
+// dropped and lex_index is left on its first
+// char to be lexed again once more text is in.
+*/
+int json_lex_range(struct json_lex_tokenstream* stream, const char* text, size_t text_size, int is_final, unsigned int flags, size_t* lex_index, struct json_error* error)
+{
+	size_t index = *lex_index;
+	while (index < text_size)
+	{
+		size_t last_index = index;
+		struct json_lex_token* token = NULL;
+		if (json_scan_empty(text, text_size, &index)) continue;
+		else if (json_scan_string(&token, text, text_size, &index));
+		else if (json_scan_null(&token, text, text_size, &index));
+		else if (json_scan_false(&token, text, text_size, &index));
+		else if (json_scan_true(&token, text, text_size, &index));
+		else if (json_scan_number(&token, text, text_size, flags, &index));
+		else if (json_scan_symbols(&token, text, &index));
+		else if (!is_final)
+		{
+			*lex_index = last_index;
+			return 1;
+		}
+		else
+		{
+			json_emit_error_at(error, last_index, ERR_JSON_MSG_LEX_INVALID_TOKEN);
+			return 0;
+		}
+		if (!is_final && index + 1 >= text_size)
+		{
+			json_util_free_token(token);
+			*lex_index = last_index;
+			return 1;
+		}
+		if (token != NULL)
+		{
+			/* One store per token, so parser errors can point at it. */
+			token->offset = last_index;
+			json_util_append_token(stream, token);
+		}
+
+		++index;
+	}
+	*lex_index = index;
+	return 1;
+}
+
+struct json_lex_tokenstream* json_lex(const char* text, size_t text_size, unsigned int flags, struct json_error* error)
+{
+	struct json_lex_tokenstream* stream = NULL;
+	size_t index = 0;
+	stream = json_util_newtokenstream();
+	if (!json_lex_range(stream, text, text_size, 1, flags, &index, error))
+	{
+		json_util_free_tokenstream(stream);
+		return NULL;
+	}
+	return stream;
+}
+/*
+//////////////////////////////////////
+//
+// JSON Validator Functions
+//
+//////////////////////////////////////
+*/
+static JSON_C_FORCEINLINE size_t json_skip_empty(const char* text, size_t text_size, size_t index)
+{
+	while (index < text_size &&
+		(text[index] == ' ' || text[index] == '\n' || text[index] == '\t' || text[index] == '\r'))
+		++index;
+	return index;
+}
+
+const char* json_validate_value(const char* text, size_t text_size, size_t* index, size_t depth)
+{
+	const char* error_msg = NULL;
+	size_t lex_index = json_skip_empty(text, text_size, *index);
+	int is_float;
+	char close;
+	*index = lex_index;
+	if (lex_index >= text_size)
+		return ERR_JSON_MSG_PAR_UNEXPECTED_END;
+	switch (text[lex_index])
+	{
+		case '"':
+			error_msg = json_check_string(text, text_size, &lex_index);
+			*index = lex_index + 1;
+			return error_msg;
+		case 't':
+			if (!json_check_literal(text, text_size, lex_index, "true", 4))
+				return ERR_JSON_MSG_PAR_INVALID_VALUE;
+			*index = lex_index + 4;
+			return NULL;
+		case 'f':
+			if (!json_check_literal(text, text_size, lex_index, "false", 5))
+				return ERR_JSON_MSG_PAR_INVALID_VALUE;
+			*index = lex_index + 5;
+			return NULL;
+		case 'n':
+			if (!json_check_literal(text, text_size, lex_index, "null", 4))
+				return ERR_JSON_MSG_PAR_INVALID_VALUE;
+			*index = lex_index + 4;
+			return NULL;
+		case '[':
+		case '{':
+			break;
+		default:
+			if (text[lex_index] != '-' && (text[lex_index] < '0' || text[lex_index] > '9'))
+				return ERR_JSON_MSG_PAR_INVALID_VALUE;
+			error_msg = json_check_number(text, text_size, &lex_index, &is_float);
+			*index = error_msg != NULL ? lex_index : lex_index + 1;
+			return error_msg;
+	}
+	if (depth >= JSON_C_MAX_DEPTH)
+		return ERR_JSON_MSG_PAR_MAX_DEPTH;
+	close = text[lex_index] == '[' ? ']' : '}';
+	lex_index = json_skip_empty(text, text_size, lex_index + 1);
+	if (lex_index < text_size && text[lex_index] == close)
+	{
+		*index = lex_index + 1;
+		return NULL;
+	}
+	for (;;)
+	{
+		if (close == '}')
+		{
+			*index = lex_index;
+			if (lex_index >= text_size)
+				return ERR_JSON_MSG_PAR_UNEXPECTED_END;
+			if (text[lex_index] != '"')
+				return ERR_JSON_MSG_PAR_INVALID_PAIR;
+			if ((error_msg = json_check_string(text, text_size, &lex_index)) != NULL)
+			{
+				*index = lex_index;
+				return error_msg;
+			}
+			lex_index = json_skip_empty(text, text_size, lex_index + 1);
+			*index = lex_index;
+			if (lex_index >= text_size)
+				return ERR_JSON_MSG_PAR_UNEXPECTED_END;
+			if (text[lex_index] != ':')
+				return ERR_JSON_MSG_PAR_MISSING_COLON;
+			++lex_index;
+		}
+		*index = lex_index;
+		if ((error_msg = json_validate_value(text, text_size, index, depth + 1)) != NULL)
+			return error_msg;
+		lex_index = json_skip_empty(text, text_size, *index);
+		*index = lex_index;
+		if (lex_index >= text_size)
+			return ERR_JSON_MSG_PAR_UNEXPECTED_END;
+		if (text[lex_index] == close)
+		{
+			*index = lex_index + 1;
+			return NULL;
+		}
+		if (text[lex_index] != ',')
+			return close == ']' ? ERR_JSON_MSG_PAR_MISSING_RSQBR : ERR_JSON_MSG_PAR_MISSING_LBRACE;
+		lex_index = json_skip_empty(text, text_size, lex_index + 1);
+	}
+}
+/*
+//////////////////////////////////////
+//
+// JSON Parser Functions
+//
+//////////////////////////////////////
+*/
+JSON_C_FORCEINLINE int json_simple_hash(const char* string, size_t len)
+{
+	int hash = 5301;
+	int i = len;
+	while (i)
+		hash = (hash * 33) ^ string[--i];
+
+	return hash;
+}
+
+/* Whether member has the given key, the hash is checked first. */
+static JSON_C_FORCEINLINE int json_util_is_key(const struct json_pair* member, int hash, const char* key, size_t key_size)
+{
+	return member->key == hash && member->key_size == key_size && memcmp(member->key_chars, key, key_size) == 0;
+}
+
+static JSON_C_FORCEINLINE void json_util_set_key(struct json_pair* member, char* key, size_t key_size)
+{
+	member->key = json_simple_hash(key, key_size);
+	member->key_size = (unsigned int)key_size;
+	member->key_chars = key;
+}
+
+/* Releases the lists of value to pool, NULL when the pool is freed next. */
+void json_free_value(struct json_value value, struct json_pool* pool)
+{
+	size_t index;
+	if (json_type(&value) == VAL_STRING)
+	{
+		json_util_free_string(&value);
+	}
+	else if (json_type(&value) == VAL_OBJECT)
+	{
+		for (index = 0; index < json_object_count(&value); ++index)
+		{
+			if (json_object_at(&value, index)->key_chars != NULL)
+				json_free(json_object_at(&value, index)->key_chars);
+			json_free_value(json_object_at(&value, index)->value, pool);
+		}
+		json_util_free_list(json_object_at(&value, 0), sizeof(struct json_pair), json_object_count(&value), pool);
+	}
+	else if (json_type(&value) == VAL_ARRAY)
+	{
+		for (index = 0; index < json_array_size(&value); ++index)
+		{
+			json_free_value(*json_array_at(&value, index), pool);
+		}
+		json_util_free_list(json_array_at(&value, 0), sizeof(struct json_value), json_array_size(&value), pool);
+	}
+}
+
+/*
+// Puts value in slot, a place in the list
+// with the given header, and drops what the
+// lists above it cache. A NULL parent makes
+// value the root of a document in slot.
+*/
+void json_util_replace_value(struct json_value* slot, struct json_value value, struct json_list_header* parent)
+{
+	if (parent == NULL)
+	{
+		json_destroy(*slot);
+		*slot = value;
+		return;
+	}
+	json_free_value(*slot, json_util_header_pool(parent));
+	*slot = value;
+	json_util_insert(slot, parent);
+	json_util_header_changed(parent);
+}
+
+struct json_value json_parse_value(struct json_lex_token** token, struct json_pool* pool, struct json_error* error)
+{
+	struct json_value value;
+	json_util_set_null(&value);
+	if ((*token) == NULL)
+	{
+		json_emit_error(error, NULL, ERR_JSON_MSG_PAR_INVALID_VALUE);
+	}
+	else if ((*token)->token_type == TOKTYPE_STRING)
+	{
+		json_util_set_string(&value, (*token)->chars_value, (*token)->chars_count);
+		(*token) = (*token)->next_token;
+	}
+	else if ((*token)->token_type == TOKTYPE_NUMBER)
+	{
+		value = (*token)->number_value;
+		(*token) = (*token)->next_token;
+	}
+	else if ((*token)->token_type == TOKTYPE_FALSE)
+	{
+		json_util_set_bool(&value, (*token)->bool_value);
+		(*token) = (*token)->next_token;
+	}
+	else if ((*token)->token_type == TOKTYPE_TRUE)
+	{
+		json_util_set_bool(&value, (*token)->bool_value);
+		(*token) = (*token)->next_token;
+	}
+	else if ((*token)->token_type == TOKTYPE_NULL)
+	{
+		(*token) = (*token)->next_token;
+	}
+	else if ((*token)->token_type == TOKTYPE_LBRACE)
+	{
+		json_parse_object(token, &value, pool, error);
+	}
+	else if ((*token)->token_type == TOKTYPE_LSQBR)
+	{
+		json_parse_array(token, &value, pool, error);
+	}
+	else
+	{
+		json_emit_error(error, *token, ERR_JSON_MSG_PAR_INVALID_VALUE);
+	}
+	return value;
+}
+
+size_t json_list_size(struct json_lex_token* token)
+{
+	size_t elem_count = 1;
+	size_t depth = 0;
+	struct json_lex_token* tok = token->next_token;
+	if (tok == NULL ||
+		tok->token_type == TOKTYPE_RSQBR ||
+		tok->token_type == TOKTYPE_RBRACE)
+		return 0;
+	for (; tok != NULL; tok = tok->next_token)
+	{
+		if (tok->token_type == TOKTYPE_LSQBR || tok->token_type == TOKTYPE_LBRACE)
+			++depth;
+		else if (tok->token_type == TOKTYPE_RSQBR || tok->token_type == TOKTYPE_RBRACE)
+		{
+			if (depth == 0)
+				break;
+			--depth;
+		}
+		else if (tok->token_type == TOKTYPE_COMMA && depth == 0)
+			++elem_count;
+	}
+	return elem_count;
+}
+
+void json_parse_list(struct json_lex_token** token, struct json_value* store, size_t element_count, struct json_pool* pool, struct json_error* error)
+{
+	size_t index = 0;
+	struct json_lex_token* last_token = NULL;
+	if (element_count == 0)
+		return;
+	store[index++] = json_parse_value(token, pool, error);
+	last_token = (*token);
+	while (index < element_count &&
+		(*token) != NULL &&
+		(*token)->token_type == TOKTYPE_COMMA)
+	{
+		*token = (*token)->next_token;
+		store[index++] = json_parse_value(token, pool, error);
+		last_token = *token;
+	}
+	while (index < element_count)
+		json_util_set_null(&store[index++]);
+	json_util_adopt_elements(store, element_count);
+	*token = last_token;
+}
+
+void json_parse_array(struct json_lex_token** token, struct json_value* value, struct json_pool* pool, struct json_error* error)
+{
+	struct json_value* elements = NULL;
+	struct json_lex_token* tok = *token;
+	size_t elem_count = 0;
+	if (tok->token_type == TOKTYPE_LSQBR)
+	{
+		elem_count = json_list_size(tok);
+		tok = tok->next_token;
+		elements = (struct json_value*)json_pool_newlist(pool, sizeof(struct json_value), elem_count);
+		json_util_set_array(value, elements, elem_count);
+		json_parse_list(&tok, elements, elem_count, pool, error);
+		if (tok == NULL || tok->token_type != TOKTYPE_RSQBR)
+		{
+			json_emit_error(error, tok, ERR_JSON_MSG_PAR_MISSING_RSQBR);
+			return;
+		}
+		*token = tok->next_token;
+	}
+}
+
+struct json_pair json_parse_pair(struct json_lex_token** token, struct json_pool* pool, struct json_error* error)
+{
+	struct json_pair pair;
+	pair.key = 0;
+	pair.key_size = 0;
+	pair.key_chars = NULL;
+	json_util_set_null(&pair.value);
+	if ((*token) != NULL &&
+		(*token)->token_type == TOKTYPE_STRING &&
+		(*token)->next_token != NULL &&
+		(*token)->next_token->token_type == TOKTYPE_COLON)
+	{
+		/* The pair takes the key text over from the token. */
+		json_util_set_key(&pair, (*token)->chars_value, (*token)->chars_count);
+		(*token)->chars_value = NULL;
+		(*token) = (*token)->next_token->next_token;
+		pair.value = json_parse_value(token, pool, error);
+	}
+	else
+	{
+		json_emit_error(error, *token, ERR_JSON_MSG_PAR_INVALID_PAIR);
+	}
+	return pair;
+}
+
+void json_parse_members(struct json_lex_token** token, struct json_pair* store, size_t element_count, struct json_pool* pool, struct json_error* error)
+{
+	size_t index = 0;
+	struct json_lex_token* last_token = NULL;
+	if (element_count == 0)
+		return;
+	store[index++] = json_parse_pair(token, pool, error);
+	last_token = (*token);
+	while (index < element_count &&
+		(*token) != NULL &&
+		(*token)->token_type == TOKTYPE_COMMA)
+	{
+		*token = (*token)->next_token;
+		store[index++] = json_parse_pair(token, pool, error);
+		last_token = *token;
+	}
+	while (index < element_count)
+	{
+		store[index].key = 0;
+		store[index].key_size = 0;
+		store[index].key_chars = NULL;
+		json_util_set_null(&store[index++].value);
+	}
+	json_util_adopt_members(store, element_count);
+	*token = last_token;
+}
+
+void json_parse_object(struct json_lex_token** token, struct json_value* value, struct json_pool* pool, struct json_error* error)
+{
+	struct json_pair* members = NULL;
+	struct json_lex_token* tok = *token;
+	size_t elem_count = 0;
+	if (tok->token_type == TOKTYPE_LBRACE)
+	{
+		elem_count = json_list_size(tok);
+		tok = tok->next_token;
+		members = (struct json_pair*)json_pool_newlist(pool, sizeof(struct json_pair), elem_count);
+		json_util_set_object(value, members, elem_count);
+		json_parse_members(&tok, members, elem_count, pool, error);
+		if (tok == NULL || tok->token_type != TOKTYPE_RBRACE)
+		{
+			json_emit_error(error, tok, ERR_JSON_MSG_PAR_MISSING_LBRACE);
+			return;
+		}
+		*token = tok->next_token;
+	}
+}
+
+/*
+// The lists of the document come from pool,
+// or from a new pool the root list owns when
+// pool is NULL.
+*/
+struct json_value json_parse_tokens(struct json_lex_tokenstream* stream, unsigned int flags, struct json_pool* pool, struct json_error* error)
+{
+	struct json_value root;
+	struct json_list_extra* extra = NULL;
+	struct json_lex_token* token = stream->head;
+	int owns_pool = 0;
+	json_util_set_null(&root);
+	if (token == NULL)
+	{
+		json_emit_error(error, NULL, ERR_JSON_MSG_PAR_INVALID_VALUE);
+		json_util_free_tokenstream(stream);
+		return root;
+	}
+	owns_pool = pool == NULL && (token->token_type == TOKTYPE_LSQBR || token->token_type == TOKTYPE_LBRACE);
+	if (owns_pool)
+		pool = json_pool_create();
+	root = json_parse_value(&token, pool, error);
+	json_util_free_tokenstream(stream);
+	if (error->failed_parse)
+	{
+		json_free_value(root, owns_pool ? NULL : pool);
+		if (owns_pool)
+			json_pool_destroy(pool);
+		json_util_set_null(&root);
+		return root;
+	}
+	if (owns_pool)
+	{
+		extra = json_util_list_extra(json_util_value_list(&root));
+		extra->pool = pool;
+		extra->owns_pool = 1;
+	}
+	if (flags & PARSE_HASH)
+		json_hash_value(&root, 1);
+	return root;
+}
+/*
+//////////////////////////////////////
+//
+// JSON File Pipeline. A reader thread
+// fills the text buffer in chunks of
+// JSON_C_FILE_CHUNK bytes while the
+// calling thread lexes the chunks that
+// are already in.
+//
+//////////////////////////////////////
+*/
+struct json_file_pipe
+{
+	FILE* file;
+	char* text;
+	size_t text_size;
+	size_t available;
+	int done;
+	int failed;
+	int cancelled;
+#if !JSON_C_NO_THREADS
+#if _WIN32
+	HANDLE thread;
+	CRITICAL_SECTION lock;
+	CONDITION_VARIABLE cond;
+#else
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+#endif
+#endif
+};
+
+#if JSON_C_NO_THREADS
+#define json_pipe_lock(pipe)
+#define json_pipe_unlock(pipe)
+#define json_pipe_signal(pipe)
+#define json_pipe_wait(pipe)
+#elif _WIN32
+#define json_pipe_lock(pipe) EnterCriticalSection(&(pipe)->lock)
+#define json_pipe_unlock(pipe) LeaveCriticalSection(&(pipe)->lock)
+#define json_pipe_signal(pipe) WakeAllConditionVariable(&(pipe)->cond)
+#define json_pipe_wait(pipe) SleepConditionVariableCS(&(pipe)->cond, &(pipe)->lock, INFINITE)
+#else
+#define json_pipe_lock(pipe) pthread_mutex_lock(&(pipe)->lock)
+#define json_pipe_unlock(pipe) pthread_mutex_unlock(&(pipe)->lock)
+#define json_pipe_signal(pipe) pthread_cond_broadcast(&(pipe)->cond)
+#define json_pipe_wait(pipe) pthread_cond_wait(&(pipe)->cond, &(pipe)->lock)
+#endif
+
+void json_file_read_chunks(struct json_file_pipe* pipe)
+{
+	size_t offset = 0;
+	while (offset < pipe->text_size)
+	{
+		size_t chunk_size = pipe->text_size - offset;
+		size_t read_size = 0;
+		if (chunk_size > JSON_C_FILE_CHUNK)
+			chunk_size = JSON_C_FILE_CHUNK;
+		read_size = fread(&pipe->text[offset], 1, chunk_size, pipe->file);
+		offset += read_size;
+		json_pipe_lock(pipe);
+		pipe->available = offset;
+		pipe->failed = read_size != chunk_size;
+		if (pipe->cancelled)
+			read_size = 0;
+		json_pipe_signal(pipe);
+		json_pipe_unlock(pipe);
+		if (read_size != chunk_size)
+			break;
+	}
+	json_pipe_lock(pipe);
+	pipe->done = 1;
+	json_pipe_signal(pipe);
+	json_pipe_unlock(pipe);
+}
+
+#if !JSON_C_NO_THREADS
+#if _WIN32
+DWORD WINAPI json_file_reader(LPVOID pipe)
+{
+	json_file_read_chunks((struct json_file_pipe*)pipe);
+	return 0;
+}
+#else
+void* json_file_reader(void* pipe)
+{
+	json_file_read_chunks((struct json_file_pipe*)pipe);
+	return NULL;
+}
+#endif
+#endif
+
+int json_file_start(struct json_file_pipe* pipe)
+{
+#if JSON_C_NO_THREADS
+	json_file_read_chunks(pipe);
+	return 1;
+#elif _WIN32
+	InitializeCriticalSection(&pipe->lock);
+	InitializeConditionVariable(&pipe->cond);
+	/* A single chunk leaves nothing to overlap. */
+	if (pipe->text_size <= JSON_C_FILE_CHUNK ||
+		(pipe->thread = CreateThread(NULL, 0, &json_file_reader, pipe, 0, NULL)) == NULL)
+		json_file_read_chunks(pipe);
+	return 1;
+#else
+	pthread_mutex_init(&pipe->lock, NULL);
+	pthread_cond_init(&pipe->cond, NULL);
+	/* A single chunk leaves nothing to overlap. */
+	if (pipe->text_size <= JSON_C_FILE_CHUNK ||
+		pthread_create(&pipe->thread, NULL, &json_file_reader, pipe) != 0)
+	{
+		pipe->thread = pthread_self();
+		json_file_read_chunks(pipe);
+	}
+	return 1;
+#endif
+}
+
+void json_file_finish(struct json_file_pipe* pipe)
+{
+#if JSON_C_NO_THREADS
+	(void)pipe;
+#elif _WIN32
+	if (pipe->thread != NULL)
+	{
+		WaitForSingleObject(pipe->thread, INFINITE);
+		CloseHandle(pipe->thread);
+	}
+	DeleteCriticalSection(&pipe->lock);
+#else
+	if (!pthread_equal(pipe->thread, pthread_self()))
+		pthread_join(pipe->thread, NULL);
+	pthread_cond_destroy(&pipe->cond);
+	pthread_mutex_destroy(&pipe->lock);
+#endif
+}
+
+/*
+// Blocks until more than available bytes are
+// in or the reader is done. Returns the new
+// amount of available bytes.
+*/
+size_t json_file_wait(struct json_file_pipe* pipe, size_t available, int* is_final)
+{
+	json_pipe_lock(pipe);
+	while (pipe->available <= available && !pipe->done)
+		json_pipe_wait(pipe);
+	available = pipe->available;
+	*is_final = pipe->done;
+	json_pipe_unlock(pipe);
+	return available;
+}
+
+/*
+// Returns the error message, or NULL once
+// size is set. The size is taken as 64 bit
+// and has to leave room for the terminator.
+*/
+const char* json_file_size(FILE* file, size_t* size)
+{
+#if _MSC_VER
+	__int64 end = 0;
+	if (_fseeki64(file, 0, SEEK_END) != 0 || (end = _ftelli64(file)) < 0 || _fseeki64(file, 0, SEEK_SET) != 0)
+		return ERR_JSON_MSG_IO_READ;
+#else
+	off_t end = 0;
+	if (fseeko(file, 0, SEEK_END) != 0 || (end = ftello(file)) < 0 || fseeko(file, 0, SEEK_SET) != 0)
+		return ERR_JSON_MSG_IO_READ;
+#endif
+	if ((json_uint64)end >= (json_uint64)(size_t)-1)
+		return ERR_JSON_MSG_IO_SIZE;
+	*size = (size_t)end;
+	return NULL;
+}
+
+/*
+//////////////////////////////////////
+//
+// JSON Incremental Parse. The old text
+// is walked once, left to right, along
+// with the tree to find the smallest value
+// holding the edit, and only that value is
+// parsed again. Values before the edit are
+// scanned once, the ones after it not at
+// all.
+//
+//////////////////////////////////////
+*/
+struct json_reparse_edit
+{
+	const char* old_text;
+	size_t old_size;
+	const char* new_text;
+	size_t edit_begin;
+	size_t edit_end;
+	size_t inserted_size;
+	unsigned int flags;
+};
+
+int json_reparse_region(struct json_reparse_edit* edit, struct json_value* value, struct json_list_header* parent, size_t begin, size_t end)
+{
+	size_t new_end = end - (edit->edit_end - edit->edit_begin) + edit->inserted_size;
+	struct json_error region_error;
+	struct json_value region;
+	if (!json_validate(&edit->new_text[begin], new_end - begin, &region_error))
+		return 0;
+	region_error.failed_parse = 0;
+	region = json_parse_in_pool(&edit->new_text[begin], new_end - begin, edit->flags, json_util_header_pool(parent), &region_error);
+	if (region_error.failed_parse)
+		return 0;
+	json_util_replace_value(value, region, parent);
+	return 1;
+}
+
+/*
+// Walks value, which starts at begin in the
+// old text. parent is the header of the list
+// holding it, NULL for the root. Returns 1
+// once the edit is parsed into the tree and
+// 0, with end set, when the edit starts
+// after value. Returns -1 when value holds
+// the edit but can not take it, so a value
+// around it has to; the root leaves that to
+// a full parse.
+*/
+int json_reparse_value(struct json_reparse_edit* edit, struct json_value* value, struct json_list_header* parent, size_t begin, size_t* end, size_t depth)
+{
+	const char* text = edit->old_text;
+	size_t text_size = edit->old_size;
+	size_t index = begin + 1;
+	size_t child_end = 0;
+	size_t count = 0;
+	size_t i = 0;
+	struct json_value* child = NULL;
+	int is_object = json_type(value) == VAL_OBJECT;
+	int is_list = is_object || json_type(value) == VAL_ARRAY;
+	int result = 0;
+	char close = is_object ? '}' : ']';
+	if (is_list && begin < text_size && text[begin] == (is_object ? '{' : '['))
+	{
+		count = is_object ? json_object_count(value) : json_array_size(value);
+		for (i = 0; i < count; ++i)
+		{
+			index = json_skip_empty(text, text_size, index);
+			if (i > 0)
+			{
+				if (index >= text_size || text[index] != ',')
+					return -1;
+				index = json_skip_empty(text, text_size, index + 1);
+			}
+			if (is_object)
+			{
+				if (index >= text_size || text[index] != '"' ||
+					json_check_string(text, text_size, &index) != NULL)
+					return -1;
+				index = json_skip_empty(text, text_size, index + 1);
+				if (index >= text_size || text[index] != ':')
+					return -1;
+				index = json_skip_empty(text, text_size, index + 1);
+				child = &json_object_at(value, i)->value;
+			}
+			else
+				child = json_array_at(value, i);
+			/* The edit starts between two values of this one. */
+			if (index > edit->edit_begin)
+				break;
+			result = json_reparse_value(edit, child, json_util_list_header(json_util_value_list(value)), index, &child_end, depth + 1);
+			if (result != 0)
+				break;
+			index = child_end;
+		}
+		if (result == 1)
+			return 1;
+		index = json_skip_empty(text, text_size, index);
+		if (i < count || result != 0 || index >= text_size || text[index] != close)
+		{
+			/* This is the smallest value holding the edit, it is scanned in full. */
+			*end = begin;
+			if (json_validate_value(text, text_size, end, depth) != NULL)
+				return -1;
+		}
+		else
+			*end = index + 1;
+	}
+	else
+	{
+		*end = begin;
+		if (json_validate_value(text, text_size, end, depth) != NULL)
+			return -1;
+	}
+	if (edit->edit_begin > *end)
+		return 0;
+	if (parent == NULL || edit->edit_end > *end)
+		return -1;
+	return json_reparse_region(edit, value, parent, begin, *end) ? 1 : -1;
+}
+
+/*
+//////////////////////////////////////
+//
+// JSON Field Index. A sorted table of
+// the elements of an array keyed by a
+// field. Integer keys sort before
+// string keys.
+//
+//////////////////////////////////////
+*/
+void json_index_free(struct json_index* index)
+{
+	while (index != NULL)
+	{
+		struct json_index* next = index->next;
+		if (index->is_valid)
+			json_free(index->entries);
+		json_free(index->key_path);
+		json_free(index);
+		index = next;
+	}
+}
+
+void json_index_invalidate(struct json_index* index)
+{
+	for (; index != NULL; index = index->next)
+	{
+		if (index->is_valid)
+			json_free(index->entries);
+		index->entries = NULL;
+		index->entry_count = 0;
+		index->is_valid = 0;
+	}
+}
+
+int json_index_compare(const struct json_index_entry* a, int is_string, json_int64 int_key, const char* string_key, size_t string_size)
+{
+	int result = 0;
+	if (a->is_string != is_string)
+		return a->is_string ? 1 : -1;
+	if (!is_string)
+		return a->int_key < int_key ? -1 : a->int_key > int_key ? 1 : 0;
+	result = memcmp(a->string_key, string_key, a->string_size < string_size ? a->string_size : string_size);
+	if (result == 0 && a->string_size != string_size)
+		return a->string_size < string_size ? -1 : 1;
+	return result;
+}
+
+int json_index_sort(const void* a, const void* b)
+{
+	const struct json_index_entry* entry = (const struct json_index_entry*)b;
+	int result = json_index_compare((const struct json_index_entry*)a, entry->is_string, entry->int_key, entry->string_key, entry->string_size);
+	if (result == 0)
+		return ((const struct json_index_entry*)a)->element < entry->element ? -1 : 1;
+	return result;
+}
+
+/* First entry that does not sort before the key. */
+size_t json_index_lower(const struct json_index* index, int is_string, json_int64 int_key, const char* string_key, size_t string_size)
+{
+	size_t low = 0;
+	size_t high = index->entry_count;
+	while (low < high)
+	{
+		size_t middle = low + (high - low) / 2;
+		if (json_index_compare(&index->entries[middle], is_string, int_key, string_key, string_size) < 0)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return low;
+}
+
+/* First entry that sorts after the key. */
+size_t json_index_upper(const struct json_index* index, int is_string, json_int64 int_key, const char* string_key, size_t string_size)
+{
+	size_t low = 0;
+	size_t high = index->entry_count;
+	while (low < high)
+	{
+		size_t middle = low + (high - low) / 2;
+		if (json_index_compare(&index->entries[middle], is_string, int_key, string_key, string_size) <= 0)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return low;
+}
+
+struct json_value* json_index_field(struct json_value* value, const char* key_path)
+{
+	const char* segment = key_path;
+	while (value != NULL && json_type(value) == VAL_OBJECT)
+	{
+		size_t index;
+		const char* segment_end = strchr(segment, '.');
+		size_t segment_size = segment_end != NULL ? (size_t)(segment_end - segment) : strlen(segment);
+		int hash = json_simple_hash(segment, segment_size);
+		struct json_value* member = NULL;
+		for (index = 0; index < json_object_count(value); ++index)
+		{
+			if (json_util_is_key(json_object_at(value, index), hash, segment, segment_size))
+			{
+				member = &json_object_at(value, index)->value;
+				break;
+			}
 		}
-		json_free(value.array_value.elements);
+		if (segment_end == NULL)
+			return member;
+		value = member;
+		segment = segment_end + 1;
+	}
+	return NULL;
+}
+
+/*
+//////////////////////////////////////
+//
+// JSON Structural Hash. Numbers hash by
+// value, so 1 and 1.0 are the same, and
+// object members are combined in an
+// order independent way.
+//
+//////////////////////////////////////
+*/
+#define JSON_C_HASH_NULL ((json_uint64)0x6e756c6c)
+#define JSON_C_HASH_TRUE ((json_uint64)0x74727565)
+#define JSON_C_HASH_FALSE ((json_uint64)0x66616c73)
+#define JSON_C_HASH_NUMBER ((json_uint64)0x6e756d62)
+#define JSON_C_HASH_STRING ((json_uint64)0x73747269)
+#define JSON_C_HASH_ARRAY ((json_uint64)0x61727261)
+#define JSON_C_HASH_OBJECT ((json_uint64)0x6f626a65)
+
+static JSON_C_FORCEINLINE json_uint64 json_hash_mix(json_uint64 hash)
+{
+	hash ^= hash >> 30;
+	hash *= JSON_C_U64(0xbf58476d, 0x1ce4e5b9);
+	hash ^= hash >> 27;
+	hash *= JSON_C_U64(0x94d049bb, 0x133111eb);
+	hash ^= hash >> 31;
+	return hash;
+}
+
+/*
+// Brings a number to one form per value:
+// 0 for int_value, 1 for uint_value and 2
+// for float_value when it is not integral.
+*/
+int json_number_canonical(const struct json_value* value, json_int64* int_value, json_uint64* uint_value, double* float_value)
+{
+	struct json_value number;
+	/* Converts a copy so raw numbers stay raw. */
+	value = json_number_convert(value, &number);
+	*int_value = 0;
+	*uint_value = 0;
+	*float_value = 0.0;
+	switch (json_number_type(value))
+	{
+		case NUM_INT:
+			*int_value = json_as_int64(value);
+			return 0;
+		case NUM_UINT:
+			*uint_value = json_as_uint64(value);
+			return 1;
+		default:
+			*float_value = json_as_float(value);
+			if (*float_value >= -9223372036854775808.0 && *float_value < 9223372036854775808.0 &&
+				(double)(json_int64)*float_value == *float_value)
+			{
+				*int_value = (json_int64)*float_value;
+				return 0;
+			}
+			if (*float_value >= 0.0 && *float_value < 18446744073709551616.0 &&
+				(double)(json_uint64)*float_value == *float_value)
+			{
+				*uint_value = (json_uint64)*float_value;
+				return 1;
+			}
+			return 2;
 	}
 }
 
-struct json_value json_parse_value(struct json_lex_token** token, struct json_error* error)
+json_uint64 json_hash_number(const struct json_value* value)
+{
+	json_int64 int_value;
+	json_uint64 uint_value;
+	double float_value;
+	json_uint64 bits = 0;
+	int form = json_number_canonical(value, &int_value, &uint_value, &float_value);
+	if (form == 0)
+		bits = (json_uint64)int_value;
+	else if (form == 1)
+		bits = uint_value;
+	else
+		memcpy(&bits, &float_value, sizeof(bits));
+	return json_hash_mix((JSON_C_HASH_NUMBER + ((json_uint64)form << 32)) ^ json_hash_mix(bits));
+}
+
+json_uint64 json_hash_string(const char* string, size_t size)
 {
-	struct json_value value;
-	if ((*token)->token_type == TOKTYPE_STRING)
-	{
-		value.type = VAL_STRING;
-		value.string_value.value = json_util_copystr((*token)->chars_value, (*token)->chars_count);
-		value.string_value.size = (*token)->chars_count;
-		(*token) = (*token)->next_token;
-	}
-	else if ((*token)->token_type == TOKTYPE_FLOAT)
-	{
-		value.type = VAL_NUMBER;
-		value.number_value.float_value = (*token)->float_value;
-		value.number_value.type = NUM_FLOAT;
-		(*token) = (*token)->next_token;
-	}
-	else if ((*token)->token_type == TOKTYPE_INT)
-	{
-		value.type = VAL_NUMBER;
-		value.number_value.int_value = (*token)->int_value;
-		value.number_value.type = NUM_INT;
-		(*token) = (*token)->next_token;
-	}
-	else if ((*token)->token_type == TOKTYPE_FALSE)
+	json_uint64 hash = JSON_C_U64(0xcbf29ce4, 0x84222325);
+	size_t index;
+	for (index = 0; index < size; ++index)
 	{
-		value.type = VAL_BOOL;
-		value.bool_value.value = (*token)->bool_value;
-		(*token) = (*token)->next_token;
+		hash ^= (unsigned char)string[index];
+		hash *= JSON_C_U64(0x100, 0x000001b3);
 	}
-	else if ((*token)->token_type == TOKTYPE_TRUE)
+	return json_hash_mix(JSON_C_HASH_STRING ^ hash);
+}
+
+int json_number_equal(const struct json_value* a, const struct json_value* b)
+{
+	json_int64 int_a, int_b;
+	json_uint64 uint_a, uint_b;
+	double float_a, float_b;
+	int form = json_number_canonical(a, &int_a, &uint_a, &float_a);
+	if (form != json_number_canonical(b, &int_b, &uint_b, &float_b))
+		return 0;
+	if (form == 0)
+		return int_a == int_b;
+	if (form == 1)
+		return uint_a == uint_b;
+	return float_a == float_b;
+}
+
+static JSON_C_FORCEINLINE json_uint64 json_stored_hash(const struct json_value* value)
+{
+	struct json_list_extra* extra = NULL;
+	if (json_type(value) == VAL_ARRAY)
+		extra = json_util_list_header(json_array_at(value, 0))->extra;
+	else if (json_type(value) == VAL_OBJECT)
+		extra = json_util_list_header(json_object_at(value, 0))->extra;
+	return extra != NULL ? extra->hash : 0;
+}
+
+/*
+//////////////////////////////////////
+//
+// JSON Builder Functions
+//
+//////////////////////////////////////
+*/
+/*
+// A list for a new container that goes in
+// the document holding the container
+// document, or that starts a document with a
+// pool of its own when there is none.
+*/
+void* json_util_document_list(const struct json_value* document, size_t element_size, size_t capacity)
+{
+	struct json_list_extra* extra = NULL;
+	struct json_pool* pool = NULL;
+	void* list = NULL;
+	int owns_pool = 0;
+	if (document != NULL)
+		pool = json_util_header_pool(json_util_value_header(document));
+	owns_pool = pool == NULL;
+	if (owns_pool)
+		pool = json_pool_create();
+	list = json_pool_newlist(pool, element_size, capacity);
+	extra = json_util_list_extra(list);
+	extra->capacity = capacity;
+	extra->pool = pool;
+	extra->owns_pool = owns_pool;
+	return list;
+}
+
+/*
+// Makes room for needed values, moving the
+// list when it is full. The caller links the
+// containers in a moved list to it again.
+*/
+void* json_util_growlist(void* list, size_t element_size, size_t size, size_t needed)
+{
+	struct json_list_header* header = json_util_list_header(list);
+	struct json_pool* pool = json_util_header_pool(header);
+	size_t old_capacity = json_util_list_capacity(list, size);
+	size_t capacity = old_capacity;
+	void* new_list = NULL;
+	if (needed <= capacity)
+		return list;
+	capacity *= 2;
+	if (capacity < needed)
+		capacity = needed;
+	if (capacity < 4)
+		capacity = 4;
+	new_list = json_pool_newlist(pool, element_size, capacity);
+	memmove(new_list, list, element_size * size);
+	json_util_list_header(new_list)->parent = header->parent;
+	json_util_list_header(new_list)->extra = header->extra;
+	json_util_list_extra(new_list)->capacity = capacity;
+	json_pool_release(pool, header, json_util_list_block(element_size, old_capacity));
+	return new_list;
+}
+
+struct json_value json_parse(const char* text, size_t text_size, struct json_error* error)
+{
+	return json_parse_ex(text, text_size, 0, error);
+}
+struct json_value json_parse_ex(const char* text, size_t text_size, unsigned int flags, struct json_error* error)
+{
+	return json_parse_in_pool(text, text_size, flags, NULL, error);
+}
+struct json_value json_parse_in_pool(const char* text, size_t text_size, unsigned int flags, struct json_pool* pool, struct json_error* error)
+{
+	struct json_value root;
+	struct json_lex_tokenstream* stream = NULL;
+	if (error != NULL)
+		error->failed_parse = 0;
+	json_util_init_alloc();
+	json_util_set_null(&root);
+	stream = json_lex(text, text_size, flags, error);
+	if (stream != NULL)
+		root = json_parse_tokens(stream, flags, pool, error);
+	json_error_locate(error, text, text_size);
+	return root;
+}
+struct json_value json_parse_file(const char* path, unsigned int flags, struct json_error* error)
+{
+	struct json_value root;
+	struct json_file_pipe pipe;
+	struct json_lex_tokenstream* stream = NULL;
+	const char* error_msg = NULL;
+	size_t lex_index = 0;
+	size_t available = 0;
+	int is_final = 0;
+	int lexed = 1;
+	if (error != NULL)
+		error->failed_parse = 0;
+	json_util_init_alloc();
+	json_util_set_null(&root);
+	/* The text is freed before returning, so numbers can not stay raw. */
+	flags &= ~(unsigned int)PARSE_RAW_NUMBERS;
+	memset(&pipe, 0, sizeof(pipe));
+	pipe.file = fopen(path, "rb");
+	if (pipe.file == NULL)
+		error_msg = ERR_JSON_MSG_IO_OPEN;
+	else if ((error_msg = json_file_size(pipe.file, &pipe.text_size)) == NULL &&
+		(pipe.text = (char*)json_malloc(pipe.text_size + 1)) == NULL)
+		error_msg = ERR_JSON_MSG_IO_SIZE;
+	if (error_msg != NULL)
 	{
-		value.type = VAL_BOOL;
-		value.bool_value.value = (*token)->bool_value;
-		(*token) = (*token)->next_token;
+		if (pipe.file != NULL)
+			fclose(pipe.file);
+		json_emit_error_at(error, 0, error_msg);
+		return root;
 	}
-	else if ((*token)->token_type == TOKTYPE_NULL)
+	stream = json_util_newtokenstream();
+	json_file_start(&pipe);
+	while (lexed && !is_final)
 	{
-		value.type = VAL_NULL;
-		(*token) = (*token)->next_token;
+		available = json_file_wait(&pipe, available, &is_final);
+		lexed = json_lex_range(stream, pipe.text, available, is_final, flags, &lex_index, error);
 	}
-	else if ((*token)->token_type == TOKTYPE_LBRACE)
+	json_pipe_lock(&pipe);
+	pipe.cancelled = 1;
+	json_pipe_unlock(&pipe);
+	json_file_finish(&pipe);
+	fclose(pipe.file);
+	if (lexed && pipe.failed)
+		json_emit_error_at(error, 0, ERR_JSON_MSG_IO_READ);
+	else if (lexed)
+		root = json_parse_tokens(stream, flags, NULL, error);
+	else
+		json_util_free_tokenstream(stream);
+	if (!pipe.failed)
+		json_error_locate(error, pipe.text, available);
+	json_free(pipe.text);
+	return root;
+}
+int json_reparse(struct json_value* root, const char* old_text, size_t old_size, size_t edit_offset, size_t edit_size,
+	const char* new_text, size_t new_size, unsigned int flags, struct json_error* error)
+{
+	struct json_reparse_edit edit;
+	struct json_value value;
+	size_t begin = 0;
+	size_t end = 0;
+	if (error != NULL)
+		error->failed_parse = 0;
+	json_util_init_alloc();
+	if (edit_offset > old_size || edit_size > old_size - edit_offset || new_size + edit_size < old_size)
 	{
-		value.type = VAL_OBJECT;
-		value.object_value = json_parse_object(token, error);
+		json_emit_error_at(error, edit_offset, ERR_JSON_MSG_PAR_INVALID_EDIT);
+		return 0;
 	}
-	else if ((*token)->token_type == TOKTYPE_LSQBR)
+	edit.old_text = old_text;
+	edit.old_size = old_size;
+	edit.new_text = new_text;
+	edit.edit_begin = edit_offset;
+	edit.edit_end = edit_offset + edit_size;
+	edit.inserted_size = new_size + edit_size - old_size;
+	edit.flags = flags;
+	/* old_text held root, so it ends where its trailing white space starts. */
+	begin = json_skip_empty(old_text, old_size, 0);
+	end = old_size;
+	while (end > begin && (old_text[end - 1] == ' ' || old_text[end - 1] == '\n' ||
+		old_text[end - 1] == '\t' || old_text[end - 1] == '\r'))
+		--end;
+	if (edit.edit_begin >= begin && edit.edit_end <= end &&
+		json_reparse_value(&edit, root, NULL, begin, &end, 0) == 1)
 	{
-		value.type = VAL_ARRAY;
-		value.array_value = json_parse_array(token, error);
+		if (flags & PARSE_HASH)
+			json_hash_value(root, 1);
+		return 1;
 	}
-	else
+	value = json_parse_ex(new_text, new_size, flags, error);
+	if (error->failed_parse)
+		return 0;
+	json_util_replace_value(root, value, json_util_value_parent(root));
+	return 1;
+}
+/*
+// With store set every array and object
+// below value keeps its hash, which is what
+// PARSE_HASH asks for. json_hash only reads
+// hashes that are already stored.
+*/
+json_uint64 json_hash_value(const struct json_value* value, int store)
+{
+	json_uint64 hash = json_stored_hash(value);
+	size_t index;
+	if (hash != 0)
+		return hash;
+	switch (json_type(value))
 	{
-		json_emit_error(error, *token, ERR_JSON_MSG_PAR_INVALID_VALUE);
+		case VAL_STRING:
+			return json_hash_string(json_as_string(value), json_string_size(value));
+		case VAL_NUMBER:
+			return json_hash_number(value);
+		case VAL_BOOL:
+			return json_hash_mix(json_as_bool(value) ? JSON_C_HASH_TRUE : JSON_C_HASH_FALSE);
+		case VAL_ARRAY:
+			hash = JSON_C_HASH_ARRAY + json_array_size(value);
+			for (index = 0; index < json_array_size(value); ++index)
+				hash = json_hash_mix(hash * 31 + json_hash_value(json_array_at(value, index), store));
+			hash = hash != 0 ? hash : 1;
+			if (store)
+				json_util_list_extra(json_array_at(value, 0))->hash = hash;
+			return hash;
+		case VAL_OBJECT:
+			hash = 0;
+			for (index = 0; index < json_object_count(value); ++index)
+			{
+				struct json_pair* member = json_object_at(value, index);
+				hash += json_hash_mix(json_hash_string(member->key_chars, member->key_size) * JSON_C_U64(0x9e3779b9, 0x7f4a7c15) ^ json_hash_value(&member->value, store));
+			}
+			hash = json_hash_mix((JSON_C_HASH_OBJECT + json_object_count(value)) ^ hash);
+			hash = hash != 0 ? hash : 1;
+			if (store)
+				json_util_list_extra(json_object_at(value, 0))->hash = hash;
+			return hash;
+		default:
+			return json_hash_mix(JSON_C_HASH_NULL);
 	}
-	return value;
 }
-
-size_t json_list_size(struct json_lex_token* token)
+json_uint64 json_hash(const struct json_value* value)
 {
-	size_t elem_count = 0;
-	struct json_lex_token* tok = token;
-	do
+	return json_hash_value(value, 0);
+}
+int json_member_equal(const struct json_pair* a, const struct json_pair* b)
+{
+	return json_util_is_key(a, b->key, b->key_chars, b->key_size) && json_equal(&a->value, &b->value);
+}
+/* How many of the count members at members equal member. */
+size_t json_member_count(const struct json_pair* members, size_t count, const struct json_pair* member)
+{
+	size_t found = 0;
+	size_t index;
+	for (index = 0; index < count; ++index)
+		found += json_member_equal(&members[index], member);
+	return found;
+}
+int json_equal(const struct json_value* a, const struct json_value* b)
+{
+	json_uint64 hash_a = json_stored_hash(a);
+	json_uint64 hash_b = json_stored_hash(b);
+	size_t index;
+	size_t other;
+	size_t count;
+	if (a == b)
+		return 1;
+	if (json_type(a) != json_type(b) || (hash_a != 0 && hash_b != 0 && hash_a != hash_b))
+		return 0;
+	switch (json_type(a))
 	{
-		tok = tok->next_token;
-		if (tok->token_type == TOKTYPE_LSQBR)
-		{
-			tok = tok->next_token;
-			int count = 1;
-			while (tok != NULL && count > 0)
+		case VAL_STRING:
+			return json_string_size(a) == json_string_size(b) &&
+				memcmp(json_as_string(a), json_as_string(b), json_string_size(a)) == 0;
+		case VAL_NUMBER:
+			return json_number_equal(a, b);
+		case VAL_BOOL:
+			return json_as_bool(a) == json_as_bool(b);
+		case VAL_ARRAY:
+			if (json_array_size(a) != json_array_size(b))
+				return 0;
+			for (index = 0; index < json_array_size(a); ++index)
 			{
-				if (tok->token_type == TOKTYPE_RSQBR)
-					--count;
-				else if (tok->token_type == TOKTYPE_LSQBR)
-					++count;
-				tok = tok->next_token;
+				if (!json_equal(json_array_at(a, index), json_array_at(b, index)))
+					return 0;
 			}
-		}
-		else if (tok->token_type == TOKTYPE_LBRACE)
-		{
-			tok = tok->next_token;
-			int count = 1;
-			while (tok != NULL && count > 0)
+			return 1;
+		case VAL_OBJECT:
+			if (json_object_count(a) != json_object_count(b))
+				return 0;
+			/*
+			// Members in the same order are the
+			// common case. After the first that
+			// differs, the rest have to be equal
+			// as multisets: every member occurs
+			// as often in a as in b.
+			*/
+			for (index = 0; index < json_object_count(a); ++index)
 			{
-				if (tok->token_type == TOKTYPE_RBRACE)
-					--count;
-				else if (tok->token_type == TOKTYPE_LBRACE)
-					++count;
-				tok = tok->next_token;
+				if (!json_member_equal(json_object_at(a, index), json_object_at(b, index)))
+					break;
 			}
-		}
-		else if (tok->token_type != TOKTYPE_COMMA)
-		{
-			tok = tok->next_token;
-		}
-		++elem_count;
-	} while (tok != NULL && tok->token_type == TOKTYPE_COMMA);
-	return elem_count;
+			count = json_object_count(a) - index;
+			for (other = index; other < json_object_count(a); ++other)
+			{
+				struct json_pair* member = json_object_at(a, other);
+				if (json_member_count(json_object_at(a, index), count, member) !=
+					json_member_count(json_object_at(b, index), count, member))
+					return 0;
+			}
+			return 1;
+		default:
+			return 1;
+	}
 }
-
-void json_parse_list(struct json_lex_token** token, struct json_value* store, size_t element_count, struct json_error* error)
+struct json_index* json_index_build(struct json_value* array, const char* key_path)
 {
-	size_t index = 0;
-	struct json_lex_token* last_token = NULL;
-	if (element_count == 0)
-		return;
-	store[index++] = json_parse_value(token, error);
-	last_token = (*token);
-	while (index < element_count &&
-		(*token)->token_type == TOKTYPE_COMMA)
+	struct json_list_extra* extra = NULL;
+	struct json_index* index = NULL;
+	struct json_value* field = NULL;
+	size_t count = 0;
+	size_t position;
+	if (json_type(array) != VAL_ARRAY)
+		return NULL;
+	extra = json_util_list_extra(json_array_at(array, 0));
+	for (index = extra->indexes; index != NULL; index = index->next)
 	{
-		*token = (*token)->next_token;
-		store[index++] = json_parse_value(token, error);
-		last_token = *token;
+		if (strcmp(index->key_path, key_path) == 0)
+			break;
 	}
-	*token = last_token;
-}
-
-struct json_array json_parse_array(struct json_lex_token** token, struct json_error* error)
-{
-	struct json_array arr;
-	struct json_lex_token* tok = *token;
-	size_t elem_count = 0;
-	if (tok->token_type == TOKTYPE_LSQBR)
+	if (index != NULL && index->is_valid)
+		return index;
+	if (index == NULL)
 	{
-		elem_count = json_list_size(tok);
-		tok = tok->next_token;
-		arr.array_size = elem_count;
-		arr.elements = JSON_C_NEWARRAY(struct json_value, elem_count);
-		json_parse_list(&tok, arr.elements, elem_count, error);
-		if (tok == NULL || tok->token_type != TOKTYPE_RSQBR)
+		index = (struct json_index*)json_malloc(sizeof(struct json_index));
+		index->key_path = json_util_copystr(key_path, strlen(key_path));
+		index->next = extra->indexes;
+		extra->indexes = index;
+	}
+	index->entries = (struct json_index_entry*)json_malloc(sizeof(struct json_index_entry) * (json_array_size(array) + 1));
+	for (position = 0; position < json_array_size(array); ++position)
+	{
+		struct json_index_entry* entry = &index->entries[count];
+		field = json_index_field(json_array_at(array, position), key_path);
+		if (field == NULL)
+			continue;
+		if (json_type(field) == VAL_STRING)
 		{
-			json_emit_error(error, tok, ERR_JSON_MSG_PAR_MISSING_RSQBR);
-			return arr;
+			entry->is_string = 1;
+			entry->int_key = 0;
+			entry->string_key = json_as_string(field);
+			entry->string_size = json_string_size(field);
 		}
-		*token = tok->next_token;
+		else if (json_type(field) == VAL_NUMBER && json_number_type(field) == NUM_INT)
+		{
+			entry->is_string = 0;
+			entry->int_key = json_as_int64(field);
+			entry->string_key = NULL;
+			entry->string_size = 0;
+		}
+		else
+			continue;
+		entry->element = json_array_at(array, position);
+		++count;
 	}
-	return arr;
+	index->entry_count = count;
+	index->is_valid = 1;
+	qsort(index->entries, count, sizeof(struct json_index_entry), &json_index_sort);
+	return index;
 }
-
-struct json_pair json_parse_pair(struct json_lex_token** token, struct json_error* error)
+int json_index_valid(const struct json_index* index)
 {
-	struct json_pair pair;
-	if ((*token)->token_type == TOKTYPE_STRING &&
-		(*token)->next_token != NULL &&
-		(*token)->next_token->token_type == TOKTYPE_COLON)
-	{
-		pair.key = json_simple_hash((*token)->chars_value, (*token)->chars_count);
-		(*token) = (*token)->next_token->next_token;
-		pair.value = json_parse_value(token, error);
-	}
-	else
+	return index != NULL && index->is_valid;
+}
+struct json_value* json_index_find_int(const struct json_index* index, json_int64 key)
+{
+	size_t position = json_index_lower(index, 0, key, NULL, 0);
+	if (position < index->entry_count && json_index_compare(&index->entries[position], 0, key, NULL, 0) == 0)
+		return index->entries[position].element;
+	return NULL;
+}
+struct json_value* json_index_find_string(const struct json_index* index, const char* key)
+{
+	size_t key_size = strlen(key);
+	size_t position = json_index_lower(index, 1, 0, key, key_size);
+	if (position < index->entry_count && json_index_compare(&index->entries[position], 1, 0, key, key_size) == 0)
+		return index->entries[position].element;
+	return NULL;
+}
+size_t json_index_range_int(const struct json_index* index, json_int64 low, json_int64 high, size_t* first)
+{
+	size_t end = json_index_upper(index, 0, high, NULL, 0);
+	*first = json_index_lower(index, 0, low, NULL, 0);
+	return end > *first ? end - *first : 0;
+}
+size_t json_index_range_string(const struct json_index* index, const char* low, const char* high, size_t* first)
+{
+	size_t end = json_index_upper(index, 1, 0, high, strlen(high));
+	*first = json_index_lower(index, 1, 0, low, strlen(low));
+	return end > *first ? end - *first : 0;
+}
+struct json_value* json_index_at(const struct json_index* index, size_t position)
+{
+	return position < index->entry_count ? index->entries[position].element : NULL;
+}
+struct json_value json_new_array(struct json_value* document, size_t capacity)
+{
+	struct json_value value;
+	json_util_init_alloc();
+	json_util_set_null(&value);
+	json_util_set_array(&value, (struct json_value*)json_util_document_list(document, sizeof(struct json_value), capacity), 0);
+	return value;
+}
+struct json_value json_new_object(struct json_value* document, size_t capacity)
+{
+	struct json_value value;
+	json_util_init_alloc();
+	json_util_set_null(&value);
+	json_util_set_object(&value, (struct json_pair*)json_util_document_list(document, sizeof(struct json_pair), capacity), 0);
+	return value;
+}
+struct json_value json_new_string(const char* string, size_t size)
+{
+	struct json_value value;
+	json_util_init_alloc();
+	json_util_set_null(&value);
+	json_util_set_string(&value, string, size);
+	return value;
+}
+struct json_value json_new_int(json_int64 number)
+{
+	struct json_value value;
+	json_util_set_null(&value);
+	json_util_set_int(&value, number);
+	return value;
+}
+struct json_value json_new_float(double number)
+{
+	struct json_value value;
+	json_util_set_null(&value);
+	json_util_set_float(&value, number);
+	return value;
+}
+struct json_value json_new_bool(int boolean)
+{
+	struct json_value value;
+	json_util_set_null(&value);
+	json_util_set_bool(&value, boolean);
+	return value;
+}
+struct json_value json_new_null()
+{
+	struct json_value value;
+	json_util_set_null(&value);
+	return value;
+}
+struct json_value* json_array_append(struct json_value* array, struct json_value value)
+{
+	struct json_value* elements = NULL;
+	size_t size = 0;
+	if (json_type(array) != VAL_ARRAY)
+		return NULL;
+	json_util_init_alloc();
+	size = json_array_size(array);
+	elements = (struct json_value*)json_util_growlist(json_array_at(array, 0), sizeof(struct json_value), size, size + 1);
+	if (elements != json_array_at(array, 0))
+		json_util_adopt_elements(elements, size);
+	json_util_list_changed(elements);
+	elements[size] = value;
+	json_util_insert(&elements[size], json_util_list_header(elements));
+	json_util_set_array(array, elements, size + 1);
+	return &elements[size];
+}
+int json_array_remove(struct json_value* array, size_t index)
+{
+	struct json_value* elements = NULL;
+	size_t size = 0;
+	if (json_type(array) != VAL_ARRAY || index >= json_array_size(array))
+		return 0;
+	size = json_array_size(array);
+	elements = json_array_at(array, 0);
+	json_util_list_changed(elements);
+	json_util_keep_capacity(elements, size);
+	json_free_value(elements[index], json_util_header_pool(json_util_list_header(elements)));
+	memmove(&elements[index], &elements[index + 1], sizeof(struct json_value) * (size - index - 1));
+	json_util_set_array(array, elements, size - 1);
+	return 1;
+}
+struct json_value* json_object_set(struct json_value* object, const char* key, struct json_value value)
+{
+	struct json_pair* members = NULL;
+	struct json_value* member = NULL;
+	size_t count = 0;
+	if (json_type(object) != VAL_OBJECT)
+		return NULL;
+	json_util_init_alloc();
+	count = json_object_count(object);
+	member = json_object_get(object, key);
+	if (member != NULL)
 	{
-		json_emit_error(error, *token, ERR_JSON_MSG_PAR_INVALID_PAIR);
+		json_util_replace_value(member, value, json_util_list_header(json_object_at(object, 0)));
+		return member;
 	}
-	return pair;
+	members = (struct json_pair*)json_util_growlist(json_object_at(object, 0), sizeof(struct json_pair), count, count + 1);
+	if (members != json_object_at(object, 0))
+		json_util_adopt_members(members, count);
+	json_util_list_changed(members);
+	json_util_set_key(&members[count], json_util_copystr(key, strlen(key)), strlen(key));
+	members[count].value = value;
+	json_util_insert(&members[count].value, json_util_list_header(members));
+	json_util_set_object(object, members, count + 1);
+	return &members[count].value;
 }
-
-void json_parse_members(struct json_lex_token** token, struct json_pair* store, size_t element_count, struct json_error* error)
+int json_object_remove(struct json_value* object, const char* key)
 {
+	struct json_pair* members = NULL;
+	struct json_value* member = NULL;
+	size_t count = 0;
 	size_t index = 0;
-	struct json_lex_token* last_token = NULL;
-	if (element_count == 0)
-		return;
-	store[index++] = json_parse_pair(token, error);
-	last_token = (*token);
-	while (index < element_count &&
-		(*token)->token_type == TOKTYPE_COMMA)
+	if (json_type(object) != VAL_OBJECT || (member = json_object_get(object, key)) == NULL)
+		return 0;
+	count = json_object_count(object);
+	members = json_object_at(object, 0);
+	index = (size_t)((struct json_pair*)((char*)member - offsetof(struct json_pair, value)) - members);
+	json_util_list_changed(members);
+	json_util_keep_capacity(members, count);
+	json_free(members[index].key_chars);
+	json_free_value(*member, json_util_header_pool(json_util_list_header(members)));
+	memmove(&members[index], &members[index + 1], sizeof(struct json_pair) * (count - index - 1));
+	json_util_set_object(object, members, count - 1);
+	return 1;
+}
+#if !JSON_C_COMPACT
+struct json_value* json_get(struct json_object* object, const char* key)
+{
+	size_t index;
+	size_t key_size = strlen(key);
+	int hash = json_simple_hash(key, key_size);
+	for (index = 0; index < object->object_count; ++index)
 	{
-		*token = (*token)->next_token;
-		store[index++] = json_parse_pair(token, error);
-		last_token = *token;
+		if (json_util_is_key(&object->members[index], hash, key, key_size))
+			return &object->members[index].value;
 	}
-	*token = last_token;
+	return NULL;
 }
-
-struct json_object json_parse_object(struct json_lex_token** token, struct json_error* error)
+#endif
+struct json_value* json_object_get(struct json_value* object, const char* key)
 {
-	struct json_object obj;
-	struct json_lex_token* tok = *token;
-	size_t elem_count = 0;
-	if (tok->token_type == TOKTYPE_LBRACE)
+	size_t index;
+	size_t key_size = strlen(key);
+	int hash = json_simple_hash(key, key_size);
+	for (index = 0; index < json_object_count(object); ++index)
 	{
-		elem_count = json_list_size(tok);
-		tok = tok->next_token;
-		obj.object_count = elem_count;
-		obj.members = JSON_C_NEWARRAY(struct json_pair, elem_count);
-		json_parse_members(&tok, obj.members, elem_count, error);
-		if (tok == NULL || tok->token_type != TOKTYPE_RBRACE)
-		{
-			json_emit_error(error, tok, ERR_JSON_MSG_PAR_MISSING_LBRACE);
-			return obj;
-		}
-		*token = tok->next_token;
+		if (json_util_is_key(json_object_at(object, index), hash, key, key_size))
+			return &json_object_at(object, index)->value;
 	}
-	return obj;
+	return NULL;
 }
-
-struct json_value json_parse(const char* text, size_t text_size, struct json_error* error)
+int json_validate(const char* text, size_t text_size, struct json_error* error)
 {
-	struct json_value root = { VAL_NULL };
-	struct json_lex_tokenstream* stream = NULL;
-	size_t line = 0;
+	size_t index = 0;
+	const char* error_msg = NULL;
 	if (error != NULL)
 		error->failed_parse = 0;
-	if (json_malloc == NULL)
-		json_malloc = &malloc;
-	if (json_free == NULL)
-		json_free = &free;
-	stream = json_lex(text, text_size, error);
-	if (stream == NULL)
+	error_msg = json_validate_value(text, text_size, &index, 0);
+	if (error_msg == NULL)
 	{
-		return root;
+		index = json_skip_empty(text, text_size, index);
+		if (index < text_size)
+			error_msg = ERR_JSON_MSG_PAR_TRAILING;
 	}
-	root = json_parse_value(&(stream->head), error);
-	json_util_free_tokenstream(stream);
-	if (error->failed_parse)
+	if (error_msg != NULL)
 	{
-		json_free_value(root);
-		return root;
+		json_emit_error_at(error, index, error_msg);
+		json_error_locate(error, text, text_size);
+		return 0;
 	}
-	return root;
+	return 1;
 }
-struct json_value* json_get(struct json_object* object, const char* key)
+void json_number_resolve(struct json_value* value)
 {
-	size_t index;
-	int hash = json_simple_hash(key, strlen(key));
-	for (index = 0; index < object->object_count; ++index)
+	struct json_value number;
+	if (json_type(value) == VAL_NUMBER && json_number_is_raw(value) && !json_util_number_resolved(value))
+		json_util_set_resolved(value, json_number_convert(value, &number));
+}
+/* Writes the digits of magnitude so they end at end. */
+char* json_util_format_uint(char* end, json_uint64 magnitude)
+{
+	do
 	{
-		if (object->members[index].key == hash)
-			return &object->members[index].value;
+		*--end = (char)('0' + magnitude % 10);
+		magnitude /= 10;
+	} while (magnitude != 0);
+	return end;
+}
+size_t json_number_write(const struct json_value* value, char* buffer, size_t buffer_size)
+{
+	char local[32];
+	size_t size = 0;
+	int is_float = 0;
+	const char* text = NULL;
+	json_int64 int_value;
+	if (json_number_is_raw(value))
+		text = json_util_raw_number(value, &size, &is_float);
+	else
+	{
+		/* sprintf, as snprintf and %lld are C99. */
+		switch (json_number_type(value))
+		{
+			case NUM_INT:
+				int_value = json_as_int64(value);
+				text = json_util_format_uint(&local[sizeof(local)], int_value < 0 ? 0 - (json_uint64)int_value : (json_uint64)int_value);
+				if (int_value < 0)
+					*(char*)--text = '-';
+				size = (size_t)(&local[sizeof(local)] - text);
+				break;
+			case NUM_UINT:
+				text = json_util_format_uint(&local[sizeof(local)], json_as_uint64(value));
+				size = (size_t)(&local[sizeof(local)] - text);
+				break;
+			default:
+				size = (size_t)sprintf(local, "%.17g", json_as_float(value));
+				text = local;
+				break;
+		}
 	}
-	return NULL;
+	if (buffer_size > 0)
+	{
+		memmove(buffer, text, size < buffer_size ? size : buffer_size - 1);
+		buffer[size < buffer_size ? size : buffer_size - 1] = 0;
+	}
+	return size;
 }
 void json_destroy(struct json_value object)
 {
-	json_free_value(object);
+	struct json_list_header* header = json_util_value_header(&object);
+	struct json_pool* pool = NULL;
+	int owns_pool = 0;
+	if (header != NULL && header->extra != NULL)
+	{
+		pool = header->extra->pool;
+		owns_pool = header->extra->owns_pool;
+	}
+	json_free_value(object, owns_pool ? NULL : pool);
+	if (owns_pool)
+		json_pool_destroy(pool);
 }
+#if !JSON_C_COMPACT
 int json_contains(struct json_object* object, const char* key)
 {
 	return json_get(object, key) != NULL;
 }
+#endif
 #if __cplusplus
 JSON_C_END_EXTERN_C
 #endif
@@ -25,6 +25,33 @@ JSON_C_BEGIN_EXTERN_C
 */
 static void* (*json_malloc)(size_t) = NULL;
 static void (*json_free)(void* ptr) = NULL;
+
+#ifndef JSON_C_INLINE
+#if _MSC_VER
+#define JSON_C_INLINE static __inline
+#elif __cplusplus || (defined(__STDC_VERSION__) && __STDC_VERSION__ >= 199901L)
+#define JSON_C_INLINE static inline
+#elif __GNUC__
+/* C89 has no inline, but GCC and Clang take __inline__ in any mode. */
+#define JSON_C_INLINE static __inline__
+#else
+#define JSON_C_INLINE static
+#endif
+#endif
+/*
+// 64 bit integers. long long is only C99,
+// older compilers take it as an extension.
+*/
+#if _MSC_VER
+typedef __int64 json_int64;
+typedef unsigned __int64 json_uint64;
+#elif __GNUC__
+__extension__ typedef long long json_int64;
+__extension__ typedef unsigned long long json_uint64;
+#else
+typedef long long json_int64;
+typedef unsigned long long json_uint64;
+#endif
 /*
 //////////////////////////////////////
 //
@@ -34,6 +61,7 @@ static void (*json_free)(void* ptr) = NULL;
 */
 struct json_pair;
 struct json_value;
+struct json_index;
 
 enum JSON_VALTYPE
 {
@@ -48,20 +76,79 @@ enum JSON_VALTYPE
 enum JSON_NUMTYPE
 {
 	NUM_FLOAT,
-	NUM_INT
+	NUM_INT,
+	NUM_UINT
 };
+enum JSON_PARSEFLAGS
+{
+	/*
+	// Numbers keep a view of their digits in
+	// the source text and are only converted
+	// on first access. The digits are kept
+	// after that, so json_number_write gives
+	// them back exactly. The text must outlive
+	// the parsed value.
+	*/
+	PARSE_RAW_NUMBERS = 0x01,
+	/*
+	// Every array and object stores its
+	// json_hash, so json_equal can tell
+	// different containers apart in O(1).
+	*/
+	PARSE_HASH = 0x02
+};
+#if JSON_C_COMPACT
+/*
+// Compact layout: every node is 16 bytes.
+// The payload holds the string, elements
+// or members pointer, the number, or the
+// characters of strings shorter than
+// JSON_C_INLINE_STRING bytes. Use the
+// accessor functions below to read it.
+*/
+#define JSON_C_INLINE_STRING 8
+#define JSON_C_FLAG_INLINE 0x01
+#define JSON_C_FLAG_INT 0x02
+#define JSON_C_FLAG_TRUE 0x04
+#define JSON_C_FLAG_UINT 0x08
+#define JSON_C_FLAG_RAW 0x10
+struct json_value
+{
+	union
+	{
+		char* string_chars;
+		char inline_chars[JSON_C_INLINE_STRING];
+		struct json_value* elements;
+		struct json_pair* members;
+		double float_value;
+		json_int64 int_value;
+		json_uint64 uint_value;
+		const char* raw_chars;
+	};
+	unsigned int size;
+	unsigned char type;
+	unsigned char flags;
+};
+#else
 struct json_string
 {
 	char* value;
 	size_t size;
 };
+/*
+// While number_raw_size is not 0 raw_value
+// points to the digits of the number in the
+// source text, and the value is only valid
+// once number_resolved is set.
+*/
 struct json_number
 {
-	enum JSON_NUMTYPE type;
+	const char* raw_value;
 	union
 	{
 		double float_value;
-		int int_value;
+		json_int64 int_value;
+		json_uint64 uint_value;
 	};
 };
 struct json_bool
@@ -81,6 +168,10 @@ struct json_object
 struct json_value
 {
 	enum JSON_VALTYPE type;
+	/* Number details, in the padding after type. */
+	unsigned int number_type : 2;
+	unsigned int number_resolved : 1;
+	unsigned int number_raw_size : 29;
 	union
 	{
 		struct json_number number_value;
@@ -90,16 +181,27 @@ struct json_value
 		struct json_array array_value;
 	};
 };
+#endif
+/*
+// key is a hash of the key text. The text
+// itself, as it is in the source with any
+// escapes, is kept in key_chars.
+*/
 struct json_pair
 {
 	int key;
+	unsigned int key_size;
+	char* key_chars;
 	struct json_value value;
 };
 struct json_error
 {
 	unsigned char failed_parse : 1;
 	const char* message;
+	/* 1 based, or 0 when the error is not in the text. */
 	int line;
+	int column;
+	size_t offset;
 };
 /*
 //////////////////////////////////////
@@ -109,9 +211,298 @@ struct json_error
 //////////////////////////////////////
 */
 struct json_value json_parse(const char* text, size_t text_size, struct json_error* error);
+struct json_value json_parse_ex(const char* text, size_t text_size, unsigned int flags, struct json_error* error);
+/*
+// Parses a file while it is being read. A
+// background thread reads the file in
+// JSON_C_FILE_CHUNK sized pieces and lexing
+// runs on the chunks that are already in.
+// Needs pthreads outside of Windows unless
+// JSON_C_NO_THREADS is defined. The text
+// is freed again, so PARSE_RAW_NUMBERS is
+// ignored here. This only hides the read,
+// so it gains where reading is slow next
+// to lexing (a cold cache, a slow disk) and
+// costs a little otherwise; bench_file.c
+// measures both.
+*/
+struct json_value json_parse_file(const char* path, unsigned int flags, struct json_error* error);
+/*
+// Updates root, parsed from old_text, after
+// the edit_size bytes at edit_offset were
+// replaced to give new_text. Only the
+// smallest value holding the edit is parsed
+// again, the rest of the tree is kept. The
+// cost is a scan of the text before the
+// edit plus that value; the text after it
+// is not read.
+// Falls back to a full parse when the edit
+// changes the structure around it. On
+// failure root is left untouched.
+// With PARSE_RAW_NUMBERS, kept values still
+// point into old_text and parsed ones into
+// new_text, so every text the tree was
+// parsed or reparsed from has to outlive it.
+*/
+int json_reparse(struct json_value* root, const char* old_text, size_t old_size, size_t edit_offset, size_t edit_size,
+	const char* new_text, size_t new_size, unsigned int flags, struct json_error* error);
+/*
+// Builds (or returns the existing) index of
+// the elements of an array by the string or
+// integer field at key_path, e.g. "user.id".
+// Elements without such a field are left
+// out. The index belongs to the array and is
+// freed with it, also when json_reparse or
+// an edit replaces the array itself.
+// Any change inside the array, through
+// json_reparse or the edit functions, makes
+// the index invalid: it then finds nothing
+// until json_index_build is called again,
+// which refills it under the same pointer.
+*/
+struct json_index* json_index_build(struct json_value* array, const char* key_path);
+struct json_value* json_index_find_int(const struct json_index* index, json_int64 key);
+struct json_value* json_index_find_string(const struct json_index* index, const char* key);
+/*
+// Range queries return how many entries have
+// a key in [low, high] and set first to the
+// position of the first one. Use
+// json_index_at to walk them in key order.
+*/
+size_t json_index_range_int(const struct json_index* index, json_int64 low, json_int64 high, size_t* first);
+size_t json_index_range_string(const struct json_index* index, const char* low, const char* high, size_t* first);
+struct json_value* json_index_at(const struct json_index* index, size_t position);
+int json_index_valid(const struct json_index* index);
+/*
+// Hash of the content of a value. It does
+// not depend on formatting or on the order
+// of object members. Only arrays and objects
+// parsed with PARSE_HASH keep their hash,
+// and edits below them drop it again.
+*/
+json_uint64 json_hash(const struct json_value* value);
+/*
+// Compares the content of two values.
+// Object members are matched by key text
+// and value in any order, duplicate keys
+// included, and numbers compare by value.
+*/
+int json_equal(const struct json_value* a, const struct json_value* b);
+/*
+//////////////////////////////////////
+//
+// Builder. Every document, parsed or
+// built, keeps its arrays and objects in
+// size class pools owned by its root and
+// freed by json_destroy on the root.
+// Pass the document a new array or object
+// will be put in, or any container inside
+// it, to share its pools; pass NULL to
+// start a new document. A document put in
+// another one hands its pools over.
+//
+//////////////////////////////////////
+*/
+struct json_value json_new_array(struct json_value* document, size_t capacity);
+struct json_value json_new_object(struct json_value* document, size_t capacity);
+struct json_value json_new_string(const char* string, size_t size);
+struct json_value json_new_int(json_int64 number);
+struct json_value json_new_float(double number);
+struct json_value json_new_bool(int boolean);
+struct json_value json_new_null();
+/*
+// Edits work on any array or object, parsed
+// or built. They take ownership of value and
+// free what they replace or remove. Pointers
+// into the edited container are invalidated,
+// and so are the indexes and stored hashes
+// of every container holding it.
+*/
+struct json_value* json_array_append(struct json_value* array, struct json_value value);
+int json_array_remove(struct json_value* array, size_t index);
+struct json_value* json_object_set(struct json_value* object, const char* key, struct json_value value);
+int json_object_remove(struct json_value* object, const char* key);
+#if !JSON_C_COMPACT
 struct json_value* json_get(struct json_object* object, const char* key);
-void json_destroy(struct json_value object);
 int json_contains(struct json_object* object, const char* key);
+#endif
+struct json_value* json_object_get(struct json_value* object, const char* key);
+void json_destroy(struct json_value object);
+/*
+// Checks that text is a single well formed
+// JSON value without allocating anything.
+// Returns 1 if valid, 0 otherwise.
+*/
+int json_validate(const char* text, size_t text_size, struct json_error* error);
+/*
+// Converts a raw number (see PARSE_RAW_NUMBERS)
+// and keeps its digits next to the value. The
+// number accessors call this, so it rarely
+// needs to be called directly. The compact
+// layout has no room for both, so there raw
+// numbers stay raw and every access converts
+// them again.
+*/
+void json_number_resolve(struct json_value* value);
+/*
+// Returns value itself, or number filled with
+// the converted value if value is still raw.
+*/
+const struct json_value* json_number_convert(const struct json_value* value, struct json_value* number);
+/*
+// Writes the decimal text of a number. Raw
+// numbers copy their original digits, even
+// after they were read. Returns the length,
+// which may exceed buffer_size.
+*/
+size_t json_number_write(const struct json_value* value, char* buffer, size_t buffer_size);
+/*
+//////////////////////////////////////
+//
+// Value Accessors. These work with
+// both the default and the compact
+// (JSON_C_COMPACT) node layout.
+//
+//////////////////////////////////////
+*/
+JSON_C_INLINE enum JSON_VALTYPE json_type(const struct json_value* value)
+{
+	return (enum JSON_VALTYPE)value->type;
+}
+#if JSON_C_COMPACT
+JSON_C_INLINE const char* json_as_string(const struct json_value* value)
+{
+	return (value->flags & JSON_C_FLAG_INLINE) ? value->inline_chars : value->string_chars;
+}
+JSON_C_INLINE size_t json_string_size(const struct json_value* value)
+{
+	return value->size;
+}
+JSON_C_INLINE int json_number_is_raw(const struct json_value* value)
+{
+	return (value->flags & JSON_C_FLAG_RAW) != 0;
+}
+JSON_C_INLINE enum JSON_NUMTYPE json_number_type(const struct json_value* value)
+{
+	struct json_value number;
+	value = json_number_convert(value, &number);
+	return (value->flags & JSON_C_FLAG_UINT) ? NUM_UINT : (value->flags & JSON_C_FLAG_INT) ? NUM_INT : NUM_FLOAT;
+}
+JSON_C_INLINE double json_as_float(const struct json_value* value)
+{
+	struct json_value number;
+	value = json_number_convert(value, &number);
+	if (value->flags & JSON_C_FLAG_UINT)
+		return (double)value->uint_value;
+	return (value->flags & JSON_C_FLAG_INT) ? (double)value->int_value : value->float_value;
+}
+JSON_C_INLINE json_int64 json_as_int64(const struct json_value* value)
+{
+	struct json_value number;
+	value = json_number_convert(value, &number);
+	if (value->flags & JSON_C_FLAG_UINT)
+		return (json_int64)value->uint_value;
+	return (value->flags & JSON_C_FLAG_INT) ? value->int_value : (json_int64)value->float_value;
+}
+JSON_C_INLINE json_uint64 json_as_uint64(const struct json_value* value)
+{
+	struct json_value number;
+	value = json_number_convert(value, &number);
+	if (value->flags & JSON_C_FLAG_UINT)
+		return value->uint_value;
+	return (value->flags & JSON_C_FLAG_INT) ? (json_uint64)value->int_value : (json_uint64)value->float_value;
+}
+JSON_C_INLINE int json_as_bool(const struct json_value* value)
+{
+	return (value->flags & JSON_C_FLAG_TRUE) != 0;
+}
+JSON_C_INLINE size_t json_array_size(const struct json_value* value)
+{
+	return value->size;
+}
+JSON_C_INLINE struct json_value* json_array_at(const struct json_value* value, size_t index)
+{
+	return &value->elements[index];
+}
+JSON_C_INLINE size_t json_object_count(const struct json_value* value)
+{
+	return value->size;
+}
+JSON_C_INLINE struct json_pair* json_object_at(const struct json_value* value, size_t index)
+{
+	return &value->members[index];
+}
+#else
+JSON_C_INLINE const char* json_as_string(const struct json_value* value)
+{
+	return value->string_value.value;
+}
+JSON_C_INLINE size_t json_string_size(const struct json_value* value)
+{
+	return value->string_value.size;
+}
+JSON_C_INLINE int json_number_is_raw(const struct json_value* value)
+{
+	return value->number_raw_size != 0;
+}
+JSON_C_INLINE enum JSON_NUMTYPE json_number_type(const struct json_value* value)
+{
+	if (value->number_raw_size != 0 && !value->number_resolved)
+		json_number_resolve((struct json_value*)value);
+	return (enum JSON_NUMTYPE)value->number_type;
+}
+JSON_C_INLINE double json_as_float(const struct json_value* value)
+{
+	switch (json_number_type(value))
+	{
+		case NUM_INT: return (double)value->number_value.int_value;
+		case NUM_UINT: return (double)value->number_value.uint_value;
+		default: return value->number_value.float_value;
+	}
+}
+JSON_C_INLINE json_int64 json_as_int64(const struct json_value* value)
+{
+	switch (json_number_type(value))
+	{
+		case NUM_INT: return value->number_value.int_value;
+		case NUM_UINT: return (json_int64)value->number_value.uint_value;
+		default: return (json_int64)value->number_value.float_value;
+	}
+}
+JSON_C_INLINE json_uint64 json_as_uint64(const struct json_value* value)
+{
+	switch (json_number_type(value))
+	{
+		case NUM_INT: return (json_uint64)value->number_value.int_value;
+		case NUM_UINT: return value->number_value.uint_value;
+		default: return (json_uint64)value->number_value.float_value;
+	}
+}
+JSON_C_INLINE int json_as_bool(const struct json_value* value)
+{
+	return value->bool_value.value;
+}
+JSON_C_INLINE size_t json_array_size(const struct json_value* value)
+{
+	return value->array_value.array_size;
+}
+JSON_C_INLINE struct json_value* json_array_at(const struct json_value* value, size_t index)
+{
+	return &value->array_value.elements[index];
+}
+JSON_C_INLINE size_t json_object_count(const struct json_value* value)
+{
+	return value->object_value.object_count;
+}
+JSON_C_INLINE struct json_pair* json_object_at(const struct json_value* value, size_t index)
+{
+	return &value->object_value.members[index];
+}
+#endif
+JSON_C_INLINE int json_as_int(const struct json_value* value)
+{
+	return (int)json_as_int64(value);
+}
 
 #endif /*JSON_C_H*/
 #if __cplusplus
@@ -20,22 +20,36 @@ int main()
 	struct json_value* my_array = NULL;
 	struct json_value* exclam = NULL;
 	struct json_value root = json_parse(sample, strlen(sample), &error);
+	int failed = 0;
 
 	/* This is optional. */
 	json_malloc = &malloc;
 	json_free = &free;
 
 	if (error.failed_parse)
-		printf("JSON Parse Error: %s @ line %d\n", error.message, error.line);
+		printf("JSON Parse Error: %s @ line %d, column %d\n", error.message, error.line, error.column);
 	else
 	{
+#if !JSON_C_COMPACT
 		my_array = json_get(&root.object_value, "my_array");
 		exclam = json_get(&my_array->array_value.elements[2].object_value, "exclam");
 		printf("%s %s%s\n", 
 			   my_array->array_value.elements[0].string_value.value,
 			   my_array->array_value.elements[1].array_value.elements[0].string_value.value,
 			   exclam->string_value.value);
+#endif
+		/* The accessors work with both node layouts. */
+		my_array = json_object_get(&root, "my_array");
+		exclam = json_object_get(json_array_at(my_array, 2), "exclam");
+		failed = json_type(my_array) != VAL_ARRAY || json_array_size(my_array) != 3 ||
+			strcmp(json_as_string(json_array_at(my_array, 0)), "Hello") != 0 ||
+			json_string_size(json_array_at(my_array, 0)) != 5 ||
+			strcmp(json_as_string(json_array_at(json_array_at(my_array, 1), 0)), "World") != 0 ||
+			json_object_count(json_array_at(my_array, 2)) != 1 ||
+			exclam == NULL || strcmp(json_as_string(exclam), "!") != 0 ||
+			json_object_get(&root, "missing") != NULL;
+		printf("Accessors: %s\n", failed ? "FAILED" : "OK");
 	}
 	json_destroy(root);
-	return 0;
+	return failed || error.failed_parse;
 }
\ No newline at end of file
@@ -0,0 +1,133 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "json_c.h"
+
+int test_report(const char* name, int ok)
+{
+	printf("%s: %s\n", name, ok ? "OK" : "FAILED");
+	return !ok;
+}
+
+/* Compares a document with a fresh parse of the text it should match. */
+int test_matches(const struct json_value* value, const char* text)
+{
+	struct json_error error;
+	struct json_value expected = json_parse(text, strlen(text), &error);
+	int ok = !error.failed_parse && json_equal(value, &expected) && json_hash(value) == json_hash(&expected);
+	json_destroy(expected);
+	return ok;
+}
+
+/* Appends past the capacity asked for, also with documents that come with pools of their own. */
+int test_append()
+{
+	struct json_value root = json_new_object(NULL, 0);
+	struct json_value list = json_new_array(&root, 2);
+	struct json_value* items = NULL;
+	struct json_value item;
+	int ok = 1;
+	int i;
+	for (i = 0; i < 100; ++i)
+		json_array_append(&list, json_new_int(i));
+	items = json_object_set(&root, "list", list);
+	for (i = 0; i < 100; ++i)
+	{
+		item = json_new_object(i % 2 ? NULL : items, 1);
+		json_object_set(&item, "id", json_new_int(i));
+		json_object_set(&item, "name", json_new_string("item", 4));
+		json_array_append(items, item);
+	}
+	ok = json_array_size(items) == 200 && json_object_count(&root) == 1;
+	for (i = 0; ok && i < 100; ++i)
+	{
+		ok = json_as_int64(json_array_at(items, i)) == i &&
+			json_as_int64(json_object_get(json_array_at(items, 100 + i), "id")) == i &&
+			strcmp(json_as_string(json_object_get(json_array_at(items, 100 + i), "name")), "item") == 0;
+	}
+	json_destroy(root);
+	return ok;
+}
+
+int test_remove()
+{
+	const char* text = "{\"a\": [1, 2, 3, 4], \"b\": {\"x\": 1, \"y\": [true], \"z\": null}}";
+	struct json_error error;
+	struct json_value root = json_parse(text, strlen(text), &error);
+	int ok = !error.failed_parse;
+	ok = ok && json_array_remove(json_object_get(&root, "a"), 0);
+	ok = ok && json_array_remove(json_object_get(&root, "a"), 2);
+	ok = ok && !json_array_remove(json_object_get(&root, "a"), 2);
+	ok = ok && json_object_remove(json_object_get(&root, "b"), "y");
+	ok = ok && !json_object_remove(json_object_get(&root, "b"), "y");
+	/* Removed lists grow again from the capacity they had. */
+	ok = ok && json_array_append(json_object_get(&root, "a"), json_new_int(5)) != NULL;
+	ok = ok && test_matches(&root, "{\"a\": [2, 3, 5], \"b\": {\"x\": 1, \"z\": null}}");
+	json_destroy(root);
+	return ok;
+}
+
+int test_replace()
+{
+	struct json_value root = json_new_object(NULL, 0);
+	struct json_value inner = json_new_array(&root, 0);
+	int ok = 1;
+	json_array_append(&inner, json_new_string("old", 3));
+	json_object_set(&root, "name", json_new_string("first", 5));
+	json_object_set(&root, "value", inner);
+	json_object_set(&root, "name", json_new_int(7));
+	json_object_set(&root, "value", json_new_object(NULL, 0));
+	ok = json_object_count(&root) == 2 &&
+		test_matches(&root, "{\"name\": 7, \"value\": {}}");
+	json_destroy(root);
+	return ok;
+}
+
+/*
+// Edits deep inside a document drop the
+// stored hashes and the indexes of every
+// container above them, also after a list
+// above them moved to grow.
+*/
+int test_invalidate()
+{
+	const char* text = "{\"a\": {\"b\": [{\"id\": 1}, {\"id\": 2}]}}";
+	struct json_error error;
+	struct json_value root = json_parse_ex(text, strlen(text), PARSE_HASH, &error);
+	struct json_value* list = NULL;
+	struct json_index* index = NULL;
+	struct json_value item;
+	int ok = !error.failed_parse;
+	if (!ok)
+		return 0;
+	list = json_object_get(json_object_get(&root, "a"), "b");
+	index = json_index_build(list, "id");
+	ok = json_index_find_int(index, 2) == json_array_at(list, 1);
+
+	item = json_new_object(&root, 1);
+	json_object_set(&item, "id", json_new_int(3));
+	json_array_append(list, item);
+	ok = ok && !json_index_valid(index) && json_index_find_int(index, 3) == NULL;
+	ok = ok && test_matches(&root, "{\"a\": {\"b\": [{\"id\": 1}, {\"id\": 2}, {\"id\": 3}]}}");
+	ok = ok && json_index_build(list, "id") == index && json_index_valid(index) &&
+		json_index_find_int(index, 3) == json_array_at(list, 2);
+
+	json_object_set(json_array_at(list, 0), "id", json_new_int(5));
+	ok = ok && !json_index_valid(index);
+	ok = ok && test_matches(&root, "{\"a\": {\"b\": [{\"id\": 5}, {\"id\": 2}, {\"id\": 3}]}}");
+	ok = ok && json_index_build(list, "id") == index &&
+		json_index_find_int(index, 1) == NULL && json_index_find_int(index, 5) == json_array_at(list, 0);
+	json_destroy(root);
+	return ok;
+}
+
+int main()
+{
+	int failed = 0;
+	failed |= test_report("Append", test_append());
+	failed |= test_report("Remove", test_remove());
+	failed |= test_report("Replace", test_replace());
+	failed |= test_report("Invalidate", test_invalidate());
+	return failed;
+}
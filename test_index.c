@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "json_c.h"
+
+const char* test_text =
+	"[{\"id\": 4, \"user\": {\"name\": \"dan\"}},"
+	" {\"id\": 1, \"user\": {\"name\": \"ann\"}},"
+	" {\"id\": 6, \"user\": {\"name\": \"eve\"}},"
+	" {\"user\": {\"name\": \"bob\"}},"
+	" {\"id\": 2.5, \"user\": {}},"
+	" {\"id\": \"7\", \"user\": {\"name\": \"cid\"}},"
+	" {\"id\": 3},"
+	" 5]";
+
+int test_report(const char* name, int ok)
+{
+	printf("%s: %s\n", name, ok ? "OK" : "FAILED");
+	return !ok;
+}
+
+json_int64 test_id(const struct json_value* element)
+{
+	return json_as_int64(json_object_get((struct json_value*)element, "id"));
+}
+
+int test_find(struct json_value* array)
+{
+	struct json_index* ids = json_index_build(array, "id");
+	struct json_index* names = json_index_build(array, "user.name");
+	return ids != NULL && json_index_build(array, "id") == ids &&
+		json_index_find_int(ids, 4) == json_array_at(array, 0) &&
+		json_index_find_int(ids, 3) == json_array_at(array, 6) &&
+		json_index_find_int(ids, 5) == NULL &&
+		json_index_find_string(ids, "7") == json_array_at(array, 5) &&
+		names != NULL &&
+		json_index_find_string(names, "bob") == json_array_at(array, 3) &&
+		json_index_find_string(names, "eve") == json_array_at(array, 2) &&
+		json_index_find_string(names, "zed") == NULL &&
+		json_index_find_int(names, 1) == NULL;
+}
+
+/* Both bounds of a range are included. */
+int test_range(struct json_value* array)
+{
+	struct json_index* ids = json_index_build(array, "id");
+	struct json_index* names = json_index_build(array, "user.name");
+	size_t first = 0;
+	int ok = json_index_range_int(ids, 3, 4, &first) == 2 &&
+		test_id(json_index_at(ids, first)) == 3 && test_id(json_index_at(ids, first + 1)) == 4;
+	ok = ok && json_index_range_int(ids, 1, 6, &first) == 4 && test_id(json_index_at(ids, first)) == 1 &&
+		test_id(json_index_at(ids, first + 3)) == 6;
+	ok = ok && json_index_range_int(ids, 6, 6, &first) == 1 && json_index_at(ids, first) == json_array_at(array, 2);
+	ok = ok && json_index_range_int(ids, 7, 10, &first) == 0;
+	ok = ok && json_index_range_int(ids, 4, 3, &first) == 0;
+	ok = ok && json_index_range_string(names, "ann", "cid", &first) == 3 &&
+		json_index_at(names, first) == json_array_at(array, 1) &&
+		json_index_at(names, first + 2) == json_array_at(array, 5);
+	ok = ok && json_index_range_string(names, "b", "c", &first) == 1 &&
+		json_index_at(names, first) == json_array_at(array, 3);
+	return ok && json_index_at(ids, 100) == NULL;
+}
+
+/* Elements without the field, or with a field that is no string or integer, are left out. */
+int test_missing(struct json_value* array)
+{
+	struct json_index* ids = json_index_build(array, "id");
+	struct json_index* missing = json_index_build(array, "user.id");
+	size_t first = 0;
+	return json_index_range_int(ids, -100, 100, &first) == 4 &&
+		missing != NULL && json_index_valid(missing) &&
+		json_index_find_int(missing, 1) == NULL &&
+		json_index_range_string(missing, "", "~", &first) == 0 &&
+		json_index_build(json_array_at(array, 0), "id") == NULL;
+}
+
+/* An edit makes the index invalid, building it again refills it under the same pointer. */
+int test_edit(struct json_value* array)
+{
+	struct json_index* ids = json_index_build(array, "id");
+	int ok = json_index_valid(ids);
+	json_object_set(json_array_at(array, 1), "id", json_new_int(42));
+	ok = ok && !json_index_valid(ids) && json_index_find_int(ids, 1) == NULL && json_index_find_int(ids, 42) == NULL;
+	ok = ok && json_index_build(array, "id") == ids && json_index_valid(ids) &&
+		json_index_find_int(ids, 1) == NULL && json_index_find_int(ids, 42) == json_array_at(array, 1);
+	json_object_set(json_object_get(json_array_at(array, 3), "user"), "name", json_new_string("bea", 3));
+	ok = ok && !json_index_valid(ids);
+	return ok && json_index_build(array, "id") == ids && json_index_find_int(ids, 42) == json_array_at(array, 1);
+}
+
+/* Growing the array moves its elements, the rebuilt index points at the new ones. */
+int test_grow(struct json_value* array)
+{
+	struct json_index* ids = json_index_build(array, "id");
+	struct json_value element;
+	int ok = 1;
+	int id;
+	for (id = 100; id < 200; ++id)
+	{
+		element = json_new_object(array, 1);
+		json_object_set(&element, "id", json_new_int(id));
+		json_array_append(array, element);
+	}
+	ok = !json_index_valid(ids) && json_index_build(array, "id") == ids;
+	for (id = 100; ok && id < 200; ++id)
+		ok = json_index_find_int(ids, id) == json_array_at(array, (size_t)id - 100 + 8);
+	return ok && json_index_find_int(ids, 4) == json_array_at(array, 0);
+}
+
+/* A reparse inside an element drops the index of the array too. */
+int test_reparse()
+{
+	const char* old_text = "{\"list\": [{\"id\": 1}, {\"id\": 2}]}";
+	const char* new_text = "{\"list\": [{\"id\": 1}, {\"id\": 8}]}";
+	struct json_error error;
+	struct json_value root = json_parse(old_text, strlen(old_text), &error);
+	struct json_index* ids = json_index_build(json_object_get(&root, "list"), "id");
+	int ok = json_index_find_int(ids, 2) != NULL;
+	ok = ok && json_reparse(&root, old_text, strlen(old_text), 28, 1, new_text, strlen(new_text), 0, &error);
+	ok = ok && !json_index_valid(ids) && json_index_build(json_object_get(&root, "list"), "id") == ids &&
+		json_index_find_int(ids, 2) == NULL && json_index_find_int(ids, 8) == json_array_at(json_object_get(&root, "list"), 1);
+	json_destroy(root);
+	return ok;
+}
+
+int main()
+{
+	struct json_error error;
+	struct json_value array = json_parse(test_text, strlen(test_text), &error);
+	int failed = error.failed_parse;
+	if (error.failed_parse)
+		printf("JSON Parse Error: %s @ line %d, column %d\n", error.message, error.line, error.column);
+	else
+	{
+		failed |= test_report("Find", test_find(&array));
+		failed |= test_report("Range", test_range(&array));
+		failed |= test_report("Missing", test_missing(&array));
+		failed |= test_report("Edit", test_edit(&array));
+		failed |= test_report("Grow", test_grow(&array));
+		failed |= test_report("Reparse", test_reparse());
+	}
+	json_destroy(array);
+	return failed;
+}
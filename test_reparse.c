@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "json_c.h"
+
+#define TEST_DOCUMENTS 400
+#define TEST_EDITS 12
+#define TEST_TEXT_SIZE 4096
+
+unsigned long test_seed = 1;
+
+unsigned long test_random(unsigned long range)
+{
+	test_seed = test_seed * 1103515245UL + 12345UL;
+	return (test_seed >> 16) % range;
+}
+
+void test_write(char* text, size_t* size, const char* part)
+{
+	size_t part_size = strlen(part);
+	if (*size + part_size < TEST_TEXT_SIZE)
+	{
+		memcpy(&text[*size], part, part_size);
+		*size += part_size;
+	}
+}
+
+/* Writes a random value, with white space and duplicate keys now and then. */
+void test_write_value(char* text, size_t* size, int depth)
+{
+	static const char* scalars[] =
+	{
+		"0", "-12", "3.25", "1e3", "-0.5E-2", "5000000000", "-9223372036854775808", "18446744073709551615",
+		"1e400", "\"\"", "\"text\"", "\"a\\n\\u0041\"", "true", "false", "null"
+	};
+	static const char* keys[] = { "\"a\"", "\"b\"", "\"id\"", "\"name\"" };
+	char number[32];
+	unsigned long count = test_random(5);
+	unsigned long index;
+	unsigned long kind = test_random(depth < 4 ? 5 : 3);
+	if (kind == 0)
+	{
+		sprintf(number, "%lu", test_random(100000));
+		test_write(text, size, number);
+	}
+	else if (kind < 3 || *size > TEST_TEXT_SIZE / 2)
+		test_write(text, size, scalars[test_random(sizeof(scalars) / sizeof(scalars[0]))]);
+	else
+	{
+		test_write(text, size, kind == 3 ? "[" : "{");
+		for (index = 0; index < count; ++index)
+		{
+			test_write(text, size, index > 0 ? (test_random(3) ? ", " : ",\n") : (test_random(2) ? " " : ""));
+			if (kind == 4)
+			{
+				test_write(text, size, keys[test_random(sizeof(keys) / sizeof(keys[0]))]);
+				test_write(text, size, ": ");
+			}
+			test_write_value(text, size, depth + 1);
+		}
+		test_write(text, size, kind == 3 ? "]" : "}");
+	}
+}
+
+/*
+// Replaces a few bytes of old_text at random
+// with a fragment that keeps the text valid
+// more often than random bytes would.
+*/
+char* test_edit(const char* old_text, size_t old_size, size_t* offset, size_t* removed, size_t* new_size)
+{
+	static const char* fragments[] =
+	{
+		"", "7", "-", ".5", "e2", "\"", "\"s\"", "x", " ", "\n", ",", ", 1", ", \"k\": 2", "\"k\": 3, ",
+		"[]", "{}", "[1, [2]]", "{\"id\": 4}", "]", "}", "true", "nul", "\\u00e9", "9223372036854775808"
+	};
+	const char* fragment = fragments[test_random(sizeof(fragments) / sizeof(fragments[0]))];
+	size_t fragment_size = strlen(fragment);
+	char* new_text = NULL;
+	*offset = (size_t)test_random((unsigned long)old_size + 1);
+	*removed = (size_t)test_random((unsigned long)(old_size - *offset < 4 ? old_size - *offset : 4) + 1);
+	*new_size = old_size - *removed + fragment_size;
+	new_text = (char*)malloc(*new_size + 1);
+	memcpy(new_text, old_text, *offset);
+	memcpy(&new_text[*offset], fragment, fragment_size);
+	memcpy(&new_text[*offset + fragment_size], &old_text[*offset + *removed], old_size - *offset - *removed);
+	new_text[*new_size] = 0;
+	return new_text;
+}
+
+/*
+// Applies a chain of random edits to one
+// document and checks after each that
+// json_reparse agrees with a fresh parse of
+// the new text. Every text stays alive until
+// the end, as raw numbers may point into it.
+*/
+int test_document(unsigned int flags)
+{
+	char* texts[TEST_EDITS + 1];
+	size_t sizes[TEST_EDITS + 1];
+	size_t text_count = 1;
+	size_t offset = 0;
+	size_t removed = 0;
+	struct json_error error;
+	struct json_error fresh_error;
+	struct json_value root;
+	struct json_value fresh;
+	int edit;
+	int reparsed;
+	int ok = 1;
+	texts[0] = (char*)malloc(TEST_TEXT_SIZE);
+	sizes[0] = 0;
+	test_write_value(texts[0], &sizes[0], 0);
+	root = json_parse_ex(texts[0], sizes[0], flags, &error);
+	for (edit = 0; ok && edit < TEST_EDITS; ++edit)
+	{
+		texts[text_count] = test_edit(texts[text_count - 1], sizes[text_count - 1], &offset, &removed, &sizes[text_count]);
+		reparsed = json_reparse(&root, texts[text_count - 1], sizes[text_count - 1], offset, removed,
+			texts[text_count], sizes[text_count], flags, &error);
+		fresh = json_parse_ex(texts[text_count], sizes[text_count], flags, &fresh_error);
+		ok = reparsed == !fresh_error.failed_parse &&
+			(!reparsed || (json_equal(&root, &fresh) && json_hash(&root) == json_hash(&fresh)));
+		if (!ok)
+			printf("Mismatch (flags %u) after editing %lu bytes at %lu:\n%.*s\n", flags,
+				(unsigned long)removed, (unsigned long)offset, (int)sizes[text_count], texts[text_count]);
+		json_destroy(fresh);
+		if (reparsed)
+			++text_count;
+		else
+			free(texts[text_count]);
+	}
+	json_destroy(root);
+	while (text_count > 0)
+		free(texts[--text_count]);
+	return ok;
+}
+
+int main()
+{
+	static const unsigned int flags[] = { 0, PARSE_HASH, PARSE_RAW_NUMBERS, PARSE_HASH | PARSE_RAW_NUMBERS };
+	int ok = 1;
+	int document;
+	size_t index;
+	for (index = 0; ok && index < sizeof(flags) / sizeof(flags[0]); ++index)
+	{
+		test_seed = 1;
+		for (document = 0; ok && document < TEST_DOCUMENTS; ++document)
+			ok = test_document(flags[index]);
+	}
+	printf("Reparse: %s\n", ok ? "OK" : "FAILED");
+	return !ok;
+}